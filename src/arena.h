@@ -54,8 +54,38 @@ struct Region {
     uintptr_t data[];
 };
 
+// Counters collected for every arena when ARENA_STATS is defined. Since it changes the
+// layout of Arena, it has to be defined for every translation unit using arenas.
+typedef struct {
+    size_t alloc_count;
+    // Bytes asked for and bytes actually taken from regions (rounded up to whole words)
+    size_t bytes_requested;
+    size_t bytes_allocated;
+    // Regions currently owned by the arena and their total capacity in bytes
+    size_t region_count;
+    size_t bytes_reserved;
+    // Allocations that didn't fit into a region of REGION_DEFAULT_CAPACITY
+    size_t oversize_count;
+    // Regions that were passed over because an allocation didn't fit into the space
+    // left in them, and how many bytes were left behind
+    size_t regions_skipped;
+    size_t bytes_skipped;
+    // arena_realloc() calls that had to move the data
+    size_t realloc_count;
+    size_t realloc_copy_bytes;
+    // Bytes in use right now and the most there ever were
+    size_t bytes_in_use;
+    size_t peak_bytes_in_use;
+    // Unused space at the end of the regions before the current one, only filled in by
+    // arena_stats()
+    size_t bytes_wasted;
+} Arena_Stats;
+
 typedef struct {
     Region *begin, *end;
+#ifdef ARENA_STATS
+    Arena_Stats stats;
+#endif // ARENA_STATS
 } Arena;
 
 typedef struct  {
@@ -81,6 +111,9 @@ void arena_reset(Arena *a);
 void arena_rewind(Arena *a, Arena_Mark m);
 void arena_free(Arena *a);
 void arena_trim(Arena *a);
+#ifdef ARENA_STATS
+Arena_Stats arena_stats(Arena *a);
+#endif // ARENA_STATS
 
 #define ARENA_DA_INIT_CAP 256
 
@@ -106,7 +139,10 @@ void arena_trim(Arena *a);
 
 #endif // ARENA_H_
 
-#ifdef ARENA_IMPLEMENTATION
+// Headers that use arenas include this one as well, so the implementation has to be
+// guarded on its own
+#if defined(ARENA_IMPLEMENTATION) && !defined(ARENA_IMPLEMENTED_)
+#define ARENA_IMPLEMENTED_
 
 #if ARENA_BACKEND == ARENA_BACKEND_LIBC_MALLOC
 #include <stdlib.h>
@@ -203,15 +239,28 @@ void free_region(Region *r)
 #  error "Unknown Arena backend"
 #endif
 
-// TODO: add debug statistic collection mode for arena
-// Should collect things like:
-// - How many times new_region was called
-// - How many times existing region was skipped
-// - How many times allocation exceeded REGION_DEFAULT_CAPACITY
+#ifdef ARENA_STATS
+#define ARENA_STAT_ADD(a, field, n) ((a)->stats.field += (n))
+#define ARENA_STAT_SUB(a, field, n) ((a)->stats.field -= (n))
+
+static size_t arena_bytes_in_use(Arena *a)
+{
+    size_t count = 0;
+    for (Region *r = a->begin; r != NULL; r = r->next) count += r->count;
+    return count*sizeof(uintptr_t);
+}
+#else
+#define ARENA_STAT_ADD(a, field, n) ((void)0)
+#define ARENA_STAT_SUB(a, field, n) ((void)0)
+#endif // ARENA_STATS
 
 void *arena_alloc(Arena *a, size_t size_bytes)
 {
     size_t size = (size_bytes + sizeof(uintptr_t) - 1)/sizeof(uintptr_t);
+    ARENA_STAT_ADD(a, alloc_count, 1);
+    ARENA_STAT_ADD(a, bytes_requested, size_bytes);
+    ARENA_STAT_ADD(a, bytes_allocated, size*sizeof(uintptr_t));
+    if (size > REGION_DEFAULT_CAPACITY) ARENA_STAT_ADD(a, oversize_count, 1);
 
     if (a->end == NULL) {
         ARENA_ASSERT(a->begin == NULL);
@@ -219,28 +268,44 @@ void *arena_alloc(Arena *a, size_t size_bytes)
         if (capacity < size) capacity = size;
         a->end = new_region(capacity);
         a->begin = a->end;
+        ARENA_STAT_ADD(a, region_count, 1);
+        ARENA_STAT_ADD(a, bytes_reserved, capacity*sizeof(uintptr_t));
     }
 
     while (a->end->count + size > a->end->capacity && a->end->next != NULL) {
+        ARENA_STAT_ADD(a, regions_skipped, 1);
+        ARENA_STAT_ADD(a, bytes_skipped, (a->end->capacity - a->end->count)*sizeof(uintptr_t));
         a->end = a->end->next;
     }
 
     if (a->end->count + size > a->end->capacity) {
         ARENA_ASSERT(a->end->next == NULL);
+        ARENA_STAT_ADD(a, regions_skipped, 1);
+        ARENA_STAT_ADD(a, bytes_skipped, (a->end->capacity - a->end->count)*sizeof(uintptr_t));
         size_t capacity = REGION_DEFAULT_CAPACITY;
         if (capacity < size) capacity = size;
         a->end->next = new_region(capacity);
         a->end = a->end->next;
+        ARENA_STAT_ADD(a, region_count, 1);
+        ARENA_STAT_ADD(a, bytes_reserved, capacity*sizeof(uintptr_t));
     }
 
     void *result = &a->end->data[a->end->count];
     a->end->count += size;
+#ifdef ARENA_STATS
+    a->stats.bytes_in_use += size*sizeof(uintptr_t);
+    if (a->stats.peak_bytes_in_use < a->stats.bytes_in_use) a->stats.peak_bytes_in_use = a->stats.bytes_in_use;
+#endif // ARENA_STATS
     return result;
 }
 
 void *arena_realloc(Arena *a, void *oldptr, size_t oldsz, size_t newsz)
 {
     if (newsz <= oldsz) return oldptr;
+    if (oldsz > 0) {
+        ARENA_STAT_ADD(a, realloc_count, 1);
+        ARENA_STAT_ADD(a, realloc_copy_bytes, oldsz);
+    }
     void *newptr = arena_alloc(a, newsz);
     char *newptr_char = (char*)newptr;
     char *oldptr_char = (char*)oldptr;
@@ -304,6 +369,9 @@ void arena_reset(Arena *a)
     }
 
     a->end = a->begin;
+#ifdef ARENA_STATS
+    a->stats.bytes_in_use = 0;
+#endif // ARENA_STATS
 }
 
 void arena_rewind(Arena *a, Arena_Mark m)
@@ -319,6 +387,9 @@ void arena_rewind(Arena *a, Arena_Mark m)
     }
 
     a->end = m.region;
+#ifdef ARENA_STATS
+    a->stats.bytes_in_use = arena_bytes_in_use(a);
+#endif // ARENA_STATS
 }
 
 void arena_free(Arena *a)
@@ -331,6 +402,9 @@ void arena_free(Arena *a)
     }
     a->begin = NULL;
     a->end = NULL;
+#ifdef ARENA_STATS
+    a->stats = (Arena_Stats) {0};
+#endif // ARENA_STATS
 }
 
 void arena_trim(Arena *a){
@@ -338,9 +412,23 @@ void arena_trim(Arena *a){
     while (r) {
         Region *r0 = r;
         r = r->next;
+        ARENA_STAT_SUB(a, region_count, 1);
+        ARENA_STAT_SUB(a, bytes_reserved, r0->capacity*sizeof(uintptr_t));
         free_region(r0);
     }
     a->end->next = NULL;
 }
 
+#ifdef ARENA_STATS
+Arena_Stats arena_stats(Arena *a)
+{
+    Arena_Stats stats = a->stats;
+    stats.bytes_wasted = 0;
+    for (Region *r = a->begin; r != NULL && r != a->end; r = r->next) {
+        stats.bytes_wasted += (r->capacity - r->count)*sizeof(uintptr_t);
+    }
+    return stats;
+}
+#endif // ARENA_STATS
+
 #endif // ARENA_IMPLEMENTATION
@@ -0,0 +1,433 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define PHANIM_STR_IMPLEMENTATION
+#include "phanim.h"
+#include "raylib.h"
+
+// Headless benchmark of the whole pipeline on a synthetic scene. Everything runs on
+// the CPU backend, so it works without a GPU or display. Every metric is a time per
+// operation (lower is better) and can be compared against a stored baseline.
+
+#define BENCH_WIDTH 1280
+#define BENCH_HEIGHT 720
+#define BENCH_FPS 60
+#define BENCH_DURATION 10.0f
+// Every timed loop runs this many times and the fastest run is reported, which is the
+// one least disturbed by whatever else the machine was doing
+#define BENCH_REPEATS 7
+#define MAX_METRICS 16
+
+typedef struct {
+    size_t circles, rects, lines, tex;
+    size_t anims;
+    size_t frames;
+    size_t seeks;
+} BenchConfig;
+
+typedef struct {
+    const char *name;
+    const char *unit;
+    double value;
+} Metric;
+
+typedef struct {
+    Metric items[MAX_METRICS];
+    size_t count;
+} Metrics;
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// Small deterministic generator, so every run builds exactly the same scene
+static uint32_t bench_rand(uint32_t *state)
+{
+    *state = *state * 1664525u + 1013904223u;
+    return *state >> 8;
+}
+
+static float bench_randf(uint32_t *state, float lo, float hi)
+{
+    return lo + (hi - lo) * (float)bench_rand(state) / (float)(1u << 24);
+}
+
+static Color bench_color(uint32_t *state)
+{
+    return (Color) { bench_rand(state) & 0xff, bench_rand(state) & 0xff, bench_rand(state) & 0xff, 255 };
+}
+
+static void metric_add(Metrics *m, const char *name, const char *unit, double value)
+{
+    if (m->count == MAX_METRICS) return;
+    m->items[m->count++] = (Metric) { name, unit, value };
+}
+
+static double fastest(const double *values, size_t count)
+{
+    double min = values[0];
+    for (size_t i = 1; i < count; i++) {
+        if (values[i] < min) min = values[i];
+    }
+    return min;
+}
+
+// Every object is created up front. The anims all play at once, spread over the
+// objects: positions, colors and sizes, so every value type gets updated.
+static void build_scene(const BenchConfig *cfg)
+{
+    uint32_t rng = 1;
+    size_t shape_count = cfg->circles + cfg->rects + cfg->lines;
+    for (size_t i = 0; i < cfg->circles; i++) {
+        Vector2 p = { bench_randf(&rng, 0, BENCH_WIDTH), bench_randf(&rng, 0, BENCH_HEIGHT) };
+        PhanimCircle(p, bench_randf(&rng, 2.0f, 30.0f), bench_color(&rng));
+    }
+    for (size_t i = 0; i < cfg->rects; i++) {
+        Vector2 p = { bench_randf(&rng, 0, BENCH_WIDTH), bench_randf(&rng, 0, BENCH_HEIGHT) };
+        Vector2 s = { bench_randf(&rng, 4.0f, 60.0f), bench_randf(&rng, 4.0f, 60.0f) };
+        PhanimRect(p, s, bench_color(&rng));
+    }
+    for (size_t i = 0; i < cfg->lines; i++) {
+        Vector2 a = { bench_randf(&rng, 0, BENCH_WIDTH), bench_randf(&rng, 0, BENCH_HEIGHT) };
+        Vector2 b = { a.x + bench_randf(&rng, -60.0f, 60.0f), a.y + bench_randf(&rng, -60.0f, 60.0f) };
+        PhanimLine(a, b, bench_color(&rng));
+    }
+    for (size_t i = 0; i < cfg->tex; i++) {
+        PhanimStr str;
+        PhanimStrInit(&str, TextFormat("x_{%zu} = \\sqrt{%zu}", i, i));
+        Vector2 p = { bench_randf(&rng, 0, BENCH_WIDTH), bench_randf(&rng, 0, BENCH_HEIGHT) };
+        PhanimTex(str, p);
+    }
+
+    for (size_t i = 0; i < shape_count; i++) {
+        PhanimAddObject(i);
+    }
+    for (size_t i = 0; i < cfg->tex; i++) {
+        PhanimAddObject(shape_count + i);
+    }
+    if (shape_count == 0) return;
+
+    PhanimBeginGroup();
+    for (size_t i = 0; i < cfg->anims; i++) {
+        size_t id = i % shape_count;
+        bool circle = id < cfg->circles;
+        Vector2 target = { bench_randf(&rng, 0, BENCH_WIDTH), bench_randf(&rng, 0, BENCH_HEIGHT) };
+        switch (i % 3) {
+            case 0: {
+                PhanimTransformPos(id, vec2(0, 0), target, BENCH_DURATION);
+            } break;
+
+            case 1: {
+                PhanimFadeColor(id, bench_color(&rng), bench_color(&rng), BENCH_DURATION);
+            } break;
+
+            case 2: {
+                if (circle) PhanimScaleSizeFloat(id, 2.0f, 30.0f, BENCH_DURATION);
+                else PhanimScaleSizeVec2(id, vec2(4, 4), vec2(60, 60), BENCH_DURATION);
+            } break;
+        }
+    }
+    PhanimEndGroup();
+}
+
+// Objects can't be removed again, so every build happens in a child process that
+// reports how long it took through a pipe
+static double time_build(const BenchConfig *cfg)
+{
+    int fds[2];
+    if (pipe(fds) != 0) return 0.0;
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        double start = now_seconds();
+        build_scene(cfg);
+        double elapsed = now_seconds() - start;
+        _exit(write(fds[1], &elapsed, sizeof(elapsed)) == sizeof(elapsed) ? 0 : 1);
+    }
+    close(fds[1]);
+    double elapsed = 0.0;
+    if (pid < 0 || read(fds[0], &elapsed, sizeof(elapsed)) != sizeof(elapsed)) elapsed = 0.0;
+    close(fds[0]);
+    if (pid > 0) waitpid(pid, NULL, 0);
+    return elapsed;
+}
+
+static bool pixel_is(const Color *frame, int x, int y, Color color)
+{
+    Color c = frame[y * BENCH_WIDTH + x];
+    return c.r == color.r && c.g == color.g && c.b == color.b;
+}
+
+// Culling must never drop objects that are on screen, in particular the big ones it
+// doesn't sort into cells: a rect covering the whole canvas, a large panel and a tex
+// object that hasn't been rasterized yet, so its size is still unknown. Runs in a child
+// process for the same reason as time_build().
+static bool check_render(const BenchConfig *cfg)
+{
+    pid_t pid = fork();
+    if (pid == 0) {
+        Color back = RED, panel = BLUE;
+        PhanimAddObject(PhanimRect(vec2(BENCH_WIDTH / 2, BENCH_HEIGHT / 2), vec2(BENCH_WIDTH, BENCH_HEIGHT), back));
+        PhanimAddObject(PhanimRect(vec2(BENCH_WIDTH / 2, BENCH_HEIGHT / 2), vec2(800, 600), panel));
+        if (cfg->tex > 0) {
+            PhanimStr str;
+            PhanimStrInit(&str, "x^2 + y^2 = r^2");
+            PhanimAddObject(PhanimTex(str, vec2(BENCH_WIDTH / 2, BENCH_HEIGHT / 2)));
+            PhanimPrepareTex();
+        }
+        PhanimUpdate(1.0f / BENCH_FPS);
+        PhanimRender();
+
+        const Color *frame = PhanimGetFramebuffer();
+        bool ok = true;
+        if (!pixel_is(frame, 10, 10, back)) {
+            fprintf(stderr, "ERROR: full-canvas rect wasn't drawn\n");
+            ok = false;
+        }
+        if (!pixel_is(frame, BENCH_WIDTH / 2 - 350, BENCH_HEIGHT / 2 - 250, panel)) {
+            fprintf(stderr, "ERROR: 800x600 rect wasn't drawn\n");
+            ok = false;
+        }
+        if (cfg->tex > 0) {
+            bool drawn = false;
+            for (int y = BENCH_HEIGHT / 2; y < BENCH_HEIGHT / 2 + 200 && !drawn; y++) {
+                for (int x = BENCH_WIDTH / 2; x < BENCH_WIDTH / 2 + 300 && !drawn; x++) {
+                    drawn = !pixel_is(frame, x, y, panel);
+                }
+            }
+            if (!drawn) {
+                fprintf(stderr, "ERROR: tex object wasn't drawn\n");
+                ok = false;
+            }
+        }
+        _exit(ok ? 0 : 1);
+    }
+    int status = 0;
+    if (pid < 0 || waitpid(pid, &status, 0) != pid) return false;
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+static void run_benchmarks(const BenchConfig *cfg, Metrics *m)
+{
+    double samples[BENCH_REPEATS];
+    const float dt = 1.0f / BENCH_FPS;
+    double start = 0.0;
+
+    for (size_t r = 0; r < BENCH_REPEATS; r++) {
+        samples[r] = time_build(cfg) * 1e3;
+    }
+    metric_add(m, "build", "ms", fastest(samples, BENCH_REPEATS));
+    build_scene(cfg);
+    PhanimPrepareTex();
+
+    // Updating is cheap, so it runs through the whole timeline each time
+    size_t updates = (size_t)(BENCH_DURATION * BENCH_FPS);
+    for (size_t r = 0; r < BENCH_REPEATS; r++) {
+        PhanimSeek(0.0f);
+        start = now_seconds();
+        for (size_t i = 0; i < updates; i++) {
+            PhanimUpdate(dt);
+        }
+        samples[r] = (now_seconds() - start) / updates * 1e6;
+    }
+    metric_add(m, "update", "us/frame", fastest(samples, BENCH_REPEATS));
+
+    // Rendering the same frame over and over would be unrealistically cache friendly,
+    // so the scene keeps moving between draws
+    for (size_t r = 0; r < BENCH_REPEATS; r++) {
+        PhanimSeek(0.0f);
+        double total = 0.0;
+        for (size_t i = 0; i < cfg->frames; i++) {
+            PhanimUpdate(dt);
+            start = now_seconds();
+            PhanimRender();
+            total += now_seconds() - start;
+        }
+        samples[r] = total / cfg->frames * 1e3;
+    }
+    metric_add(m, "render", "ms/frame", fastest(samples, BENCH_REPEATS));
+
+    for (size_t r = 0; r < BENCH_REPEATS; r++) {
+        uint32_t rng = 7;
+        start = now_seconds();
+        for (size_t i = 0; i < cfg->seeks; i++) {
+            PhanimSeek(bench_randf(&rng, 0.0f, PhanimTotalAnimTime()));
+        }
+        samples[r] = (now_seconds() - start) / cfg->seeks * 1e6;
+    }
+    metric_add(m, "seek", "us/seek", fastest(samples, BENCH_REPEATS));
+
+    // What render_video does per frame minus the encoder: update, draw and hand the
+    // raw frame to a pipe-like sink
+    size_t frame_size = BENCH_WIDTH * BENCH_HEIGHT * sizeof(Color);
+    u8 *frame = MemAlloc(frame_size);
+    FILE *sink = fopen("/dev/null", "wb");
+    for (size_t r = 0; r < BENCH_REPEATS && sink != NULL; r++) {
+        PhanimSeek(0.0f);
+        start = now_seconds();
+        for (size_t i = 0; i < cfg->frames; i++) {
+            PhanimRender();
+            memcpy(frame, PhanimGetFramebuffer(), frame_size);
+            fwrite(frame, frame_size, 1, sink);
+            PhanimUpdate(dt);
+        }
+        samples[r] = (now_seconds() - start) / cfg->frames * 1e3;
+    }
+    if (sink != NULL) {
+        fclose(sink);
+        metric_add(m, "export", "ms/frame", fastest(samples, BENCH_REPEATS));
+    }
+    MemFree(frame);
+}
+
+// Scenes of different sizes aren't comparable, so baselines record the config
+static void config_string(const BenchConfig *cfg, char *buf, size_t size)
+{
+    snprintf(
+        buf, size, "# circles=%zu rects=%zu lines=%zu tex=%zu anims=%zu frames=%zu seeks=%zu",
+        cfg->circles, cfg->rects, cfg->lines, cfg->tex, cfg->anims, cfg->frames, cfg->seeks
+    );
+}
+
+// Baselines are the config line followed by `name value` lines
+static bool compare_baseline(const char *path, const BenchConfig *cfg, const Metrics *m, double threshold)
+{
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        fprintf(stderr, "Couldn't open baseline '%s'\n", path);
+        return false;
+    }
+
+    char line[256], config[256];
+    config_string(cfg, config, sizeof(config));
+    if (fgets(line, sizeof(line), f) == NULL || strncmp(line, config, strlen(config)) != 0) {
+        fprintf(stderr, "Baseline '%s' was recorded with a different scene:\n    %s\n", path, config);
+        fclose(f);
+        return false;
+    }
+
+    bool ok = true;
+    printf("\n%-10s %12s %12s %9s\n", "metric", "baseline", "current", "change");
+    while (fgets(line, sizeof(line), f) != NULL) {
+        char name[64];
+        double base;
+        if (sscanf(line, "%63s %lf", name, &base) != 2) continue;
+        for (size_t i = 0; i < m->count; i++) {
+            if (strcmp(m->items[i].name, name) != 0) continue;
+            double change = base > 0.0 ? m->items[i].value / base - 1.0 : 0.0;
+            bool regressed = change > threshold;
+            printf(
+                "%-10s %12.3f %12.3f %+8.1f%%%s\n", name, base, m->items[i].value,
+                change * 100.0, regressed ? "  REGRESSION" : ""
+            );
+            ok = ok && !regressed;
+        }
+    }
+    fclose(f);
+    return ok;
+}
+
+static bool write_baseline(const char *path, const BenchConfig *cfg, const Metrics *m)
+{
+    FILE *f = fopen(path, "w");
+    if (f == NULL) {
+        fprintf(stderr, "Couldn't write baseline '%s'\n", path);
+        return false;
+    }
+    char config[256];
+    config_string(cfg, config, sizeof(config));
+    fprintf(f, "%s\n", config);
+    for (size_t i = 0; i < m->count; i++) {
+        fprintf(f, "%s %.3f\n", m->items[i].name, m->items[i].value);
+    }
+    fclose(f);
+    return true;
+}
+
+static void usage(const char *program)
+{
+    fprintf(stderr, "Usage: %s [options]\n", program);
+    fprintf(stderr, "    --circles N --rects N --lines N\n");
+    fprintf(stderr, "                    Shapes in the scene (default 1000 each)\n");
+    fprintf(stderr, "    --tex K         Tex objects, needs pdflatex and dvisvgm (default 0)\n");
+    fprintf(stderr, "    --anims M       Anims playing at the same time (default 3000)\n");
+    fprintf(stderr, "    --frames F      Frames per timed loop (default 60)\n");
+    fprintf(stderr, "    --seeks S       Random seeks per timed loop (default 1000)\n");
+    fprintf(stderr, "    --baseline FILE Compare against FILE and fail on regressions\n");
+    fprintf(stderr, "    --threshold P   Allowed slowdown in percent (default 20)\n");
+    fprintf(stderr, "    --write-baseline FILE\n");
+    fprintf(stderr, "                    Store the results as the new baseline\n");
+}
+
+int main(int argc, char **argv)
+{
+    BenchConfig cfg = {
+        .circles = 1000,
+        .rects = 1000,
+        .lines = 1000,
+        .tex = 0,
+        .anims = 3000,
+        .frames = 60,
+        .seeks = 1000,
+    };
+    const char *baseline = NULL;
+    const char *new_baseline = NULL;
+    double threshold = 20.0;
+
+    for (int i = 1; i < argc; i++) {
+        size_t *count = NULL;
+        if (strcmp(argv[i], "--circles") == 0) count = &cfg.circles;
+        else if (strcmp(argv[i], "--rects") == 0) count = &cfg.rects;
+        else if (strcmp(argv[i], "--lines") == 0) count = &cfg.lines;
+        else if (strcmp(argv[i], "--tex") == 0) count = &cfg.tex;
+        else if (strcmp(argv[i], "--anims") == 0) count = &cfg.anims;
+        else if (strcmp(argv[i], "--frames") == 0) count = &cfg.frames;
+        else if (strcmp(argv[i], "--seeks") == 0) count = &cfg.seeks;
+
+        if (count != NULL && i + 1 < argc) {
+            *count = (size_t)strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+            baseline = argv[++i];
+        } else if (strcmp(argv[i], "--write-baseline") == 0 && i + 1 < argc) {
+            new_baseline = argv[++i];
+        } else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) {
+            threshold = atof(argv[++i]);
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (cfg.frames == 0) cfg.frames = 1;
+    if (cfg.seeks == 0) cfg.seeks = 1;
+
+    SetTraceLogLevel(LOG_WARNING);
+    PhanimInitEx(RB_CPU, BENCH_WIDTH, BENCH_HEIGHT);
+    printf(
+        "Scene: %zu circles, %zu rects, %zu lines, %zu tex, %zu concurrent anims\n",
+        cfg.circles, cfg.rects, cfg.lines, cfg.tex, cfg.anims
+    );
+
+    if (!check_render(&cfg)) {
+        PhanimDeinit();
+        return 1;
+    }
+    Metrics m = {0};
+    run_benchmarks(&cfg, &m);
+    PhanimDeinit();
+
+    for (size_t i = 0; i < m.count; i++) {
+        printf("%-10s %12.3f %s\n", m.items[i].name, m.items[i].value, m.items[i].unit);
+    }
+
+    bool ok = true;
+    if (new_baseline != NULL) ok = write_baseline(new_baseline, &cfg, &m);
+    if (baseline != NULL) ok = compare_baseline(baseline, &cfg, &m, threshold / 100.0) && ok;
+    return ok ? 0 : 1;
+}
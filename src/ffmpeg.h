@@ -0,0 +1,21 @@
+#ifndef FFMPEG_H_
+#define FFMPEG_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef struct FFMPEG FFMPEG;
+
+// Spawns an `ffmpeg` child process that reads raw RGBA frames from a pipe and
+// encodes them into `output_path`
+FFMPEG *ffmpeg_start_rendering(const char *output_path, size_t width, size_t height, size_t fps);
+bool ffmpeg_send_frame(FFMPEG *ffmpeg, void *data, size_t width, size_t height);
+// Same as ffmpeg_send_frame(), but the rows are sent bottom to top. Pixels read back
+// from an OpenGL framebuffer are upside down.
+bool ffmpeg_send_frame_flipped(FFMPEG *ffmpeg, void *data, size_t width, size_t height);
+bool ffmpeg_end_rendering(FFMPEG *ffmpeg, bool cancel);
+// Joins already encoded videos with identical parameters into `output_path` without
+// re-encoding them
+bool ffmpeg_concat(const char **input_paths, size_t count, const char *output_path);
+
+#endif // FFMPEG_H_
@@ -0,0 +1,198 @@
+// Based on 'https://github.com/tsoding/rendering-video-in-c-with-ffmpeg'
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "ffmpeg.h"
+
+#define READ_END 0
+#define WRITE_END 1
+
+struct FFMPEG {
+    int pipe;
+    pid_t pid;
+};
+
+FFMPEG *ffmpeg_start_rendering(const char *output_path, size_t width, size_t height, size_t fps)
+{
+    int pipefd[2];
+    if (pipe(pipefd) < 0) {
+        fprintf(stderr, "ERROR: could not create a pipe: %s\n", strerror(errno));
+        return NULL;
+    }
+
+    pid_t child = fork();
+    if (child < 0) {
+        fprintf(stderr, "ERROR: could not fork a child: %s\n", strerror(errno));
+        close(pipefd[READ_END]);
+        close(pipefd[WRITE_END]);
+        return NULL;
+    }
+
+    if (child == 0) {
+        if (dup2(pipefd[READ_END], STDIN_FILENO) < 0) {
+            fprintf(stderr, "ERROR: could not reopen read end of pipe as stdin: %s\n", strerror(errno));
+            _exit(1);
+        }
+        close(pipefd[READ_END]);
+        close(pipefd[WRITE_END]);
+
+        char resolution[64];
+        snprintf(resolution, sizeof(resolution), "%zux%zu", width, height);
+        char framerate[64];
+        snprintf(framerate, sizeof(framerate), "%zu", fps);
+
+        int ret = execlp("ffmpeg",
+            "ffmpeg",
+            "-loglevel", "error",
+            "-y",
+
+            "-f", "rawvideo",
+            "-pix_fmt", "rgba",
+            "-s", resolution,
+            "-r", framerate,
+            "-i", "-",
+
+            "-c:v", "libx264",
+            "-preset", "veryfast",
+            "-pix_fmt", "yuv420p",
+            output_path,
+
+            NULL
+        );
+        if (ret < 0) {
+            fprintf(stderr, "ERROR: could not run ffmpeg as a child process: %s\n", strerror(errno));
+            _exit(1);
+        }
+        // execlp() never returns on success
+        _exit(1);
+    }
+
+    close(pipefd[READ_END]);
+    // A dead encoder should surface as a failed write, not kill the renderer
+    signal(SIGPIPE, SIG_IGN);
+
+    FFMPEG *ffmpeg = malloc(sizeof(FFMPEG));
+    if (ffmpeg == NULL) {
+        close(pipefd[WRITE_END]);
+        return NULL;
+    }
+    ffmpeg->pid = child;
+    ffmpeg->pipe = pipefd[WRITE_END];
+    return ffmpeg;
+}
+
+static bool ffmpeg_write_all(FFMPEG *ffmpeg, const char *data, size_t size)
+{
+    while (size > 0) {
+        ssize_t n = write(ffmpeg->pipe, data, size);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            fprintf(stderr, "ERROR: could not write to ffmpeg: %s\n", strerror(errno));
+            return false;
+        }
+        data += n;
+        size -= (size_t)n;
+    }
+    return true;
+}
+
+bool ffmpeg_send_frame(FFMPEG *ffmpeg, void *data, size_t width, size_t height)
+{
+    return ffmpeg_write_all(ffmpeg, data, sizeof(unsigned int) * width * height);
+}
+
+bool ffmpeg_send_frame_flipped(FFMPEG *ffmpeg, void *data, size_t width, size_t height)
+{
+    const char *pixels = data;
+    size_t stride = sizeof(unsigned int) * width;
+    for (size_t y = height; y > 0; --y) {
+        if (!ffmpeg_write_all(ffmpeg, pixels + (y - 1) * stride, stride)) return false;
+    }
+    return true;
+}
+
+bool ffmpeg_end_rendering(FFMPEG *ffmpeg, bool cancel)
+{
+    int pipe = ffmpeg->pipe;
+    pid_t pid = ffmpeg->pid;
+    free(ffmpeg);
+
+    close(pipe);
+    if (cancel) kill(pid, SIGKILL);
+
+    for (;;) {
+        int wstatus = 0;
+        if (waitpid(pid, &wstatus, 0) < 0) {
+            fprintf(stderr, "ERROR: could not wait on ffmpeg (pid %d): %s\n", pid, strerror(errno));
+            return false;
+        }
+
+        if (WIFEXITED(wstatus)) {
+            int exit_status = WEXITSTATUS(wstatus);
+            if (exit_status != 0) {
+                fprintf(stderr, "ERROR: ffmpeg exited with code %d\n", exit_status);
+                return false;
+            }
+            return true;
+        }
+
+        if (WIFSIGNALED(wstatus)) {
+            if (cancel) return true;
+            fprintf(stderr, "ERROR: ffmpeg got terminated by %s\n", strsignal(WTERMSIG(wstatus)));
+            return false;
+        }
+    }
+}
+
+bool ffmpeg_concat(const char **input_paths, size_t count, const char *output_path)
+{
+    // The concat demuxer reads the list of inputs from a file
+    char list_path[4096];
+    snprintf(list_path, sizeof(list_path), "%s.concat.txt", output_path);
+    FILE *list = fopen(list_path, "w");
+    if (list == NULL) {
+        fprintf(stderr, "ERROR: could not open '%s': %s\n", list_path, strerror(errno));
+        return false;
+    }
+    for (size_t i = 0; i < count; i++) {
+        // Relative entries are resolved against the list's directory, so use absolute ones
+        char *path = realpath(input_paths[i], NULL);
+        fprintf(list, "file '%s'\n", path != NULL ? path : input_paths[i]);
+        free(path);
+    }
+    fclose(list);
+
+    pid_t child = fork();
+    if (child < 0) {
+        fprintf(stderr, "ERROR: could not fork a child: %s\n", strerror(errno));
+        unlink(list_path);
+        return false;
+    }
+
+    if (child == 0) {
+        execlp("ffmpeg",
+            "ffmpeg",
+            "-loglevel", "error",
+            "-y",
+            "-f", "concat",
+            "-safe", "0",
+            "-i", list_path,
+            "-c", "copy",
+            output_path,
+            NULL
+        );
+        fprintf(stderr, "ERROR: could not run ffmpeg as a child process: %s\n", strerror(errno));
+        _exit(1);
+    }
+
+    int wstatus = 0;
+    bool ok = waitpid(child, &wstatus, 0) == child && WIFEXITED(wstatus) && WEXITSTATUS(wstatus) == 0;
+    if (!ok) fprintf(stderr, "ERROR: could not concatenate the videos into '%s'\n", output_path);
+    unlink(list_path);
+    return ok;
+}
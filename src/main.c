@@ -2,21 +2,143 @@
 #include "phanim.h"
 #include "raylib.h"
 #include "scene.c"
+#include <libgen.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <unistd.h>
 
-int main(void)
+// Compiled scenes are mapped as they are, anything else is read as a textual scene
+static bool load_scene(const char *path)
+{
+    if (IsFileExtension(path, ".phanim")) return PhanimLoadSceneText(path);
+    return PhanimLoadScene(path);
+}
+
+// Watches the directory of the scene rather than the file itself: editors and scenec
+// replace files by renaming a new one over them, which a watch on the file wouldn't see
+static int watch_scene(const char *path, char *name, size_t name_size)
+{
+    char dir[4096], base[4096];
+    snprintf(dir, sizeof(dir), "%s", path);
+    snprintf(base, sizeof(base), "%s", path);
+    snprintf(name, name_size, "%s", basename(base));
+
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0) return -1;
+    if (inotify_add_watch(fd, dirname(dir), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Drains every pending event, so a save that touches the file several times only
+// causes one reload
+static bool scene_changed(int fd, const char *name)
+{
+    bool changed = false;
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t len;
+    while ((len = read(fd, buf, sizeof(buf))) > 0) {
+        for (char *p = buf; p < buf + len; ) {
+            struct inotify_event *e = (struct inotify_event *)p;
+            if (e->len > 0 && strcmp(e->name, name) == 0) changed = true;
+            p += sizeof(*e) + e->len;
+        }
+    }
+    return changed;
+}
+
+// Rolling histogram of the profiled phases: one stacked bar per frame, oldest on the
+// left, with the 60 fps budget as a line and p50/p99 per phase underneath
+static void draw_profile(int x, int y)
+{
+    const Color colors[PP_COUNT] = {
+        [PP_UPDATE] = YELLOW,
+        [PP_RENDER_LINE] = SKYBLUE,
+        [PP_RENDER_RECT] = BLUE,
+        [PP_RENDER_CIRCLE] = DARKBLUE,
+        [PP_RENDER_TEX] = PURPLE,
+        [PP_RENDER_BIN] = VIOLET,
+        [PP_TEX_RASTER] = RED,
+        [PP_READBACK] = ORANGE,
+        [PP_ENCODE] = BROWN,
+        [PP_FRAME] = WHITE,
+    };
+    const int width = 300, height = 100;
+    const float max_ms = 2.0f * 1000.0f / 60.0f;
+    DrawRectangle(x, y, width, height, Fade(BLACK, 0.6f));
+
+    size_t count = PhanimProfileFrameCount();
+    for (size_t ago = 0; ago < count && ago < (size_t)width; ago++) {
+        int bx = x + width - 1 - (int)ago;
+        float ms = 0.0f;
+        for (int p = 0; p < PP_FRAME; p++) {
+            float h = PhanimProfileGet(p, ago) / max_ms * height;
+            float base = ms / max_ms * height;
+            if (base >= height) break;
+            DrawRectangle(bx, y + height - (int)(base + h), 1, (int)fmaxf(h, 1.0f), colors[p]);
+            ms += PhanimProfileGet(p, ago);
+        }
+        // Wall time includes waiting for vsync, so it's only a dot
+        float frame = fminf(PhanimProfileGet(PP_FRAME, ago) / max_ms, 1.0f) * height;
+        DrawPixel(bx, y + height - (int)frame, colors[PP_FRAME]);
+    }
+    DrawLine(x, y + height / 2, x + width, y + height / 2, Fade(WHITE, 0.5f));
+
+    for (int p = 0; p < PP_COUNT; p++) {
+        int ty = y + height + 4 + p * 12;
+        DrawRectangle(x, ty + 2, 8, 8, colors[p]);
+        DrawText(
+            TextFormat(
+                "%-14s p50 %6.2f  p99 %6.2f ms", PhanimPhaseName(p),
+                PhanimProfilePercentile(p, 50.0f), PhanimProfilePercentile(p, 99.0f)
+            ),
+            x + 12, ty, 10, WHITE
+        );
+    }
+}
+
+int main(int argc, char **argv)
 {
     SetConfigFlags(FLAG_MSAA_4X_HINT);
     InitWindow(800, 600, "Physics Animations");
     SetTargetFPS(60);
+    PhanimInit();
 
-    SceneMain();
+    if (argc > 1) {
+        if (!load_scene(argv[1])) {
+            TraceLog(LOG_ERROR, "Couldn't load scene '%s'", argv[1]);
+            CloseWindow();
+            return 1;
+        }
+    } else {
+        SceneMain();
+    }
+    PhanimPrepareTex();
     TraceLog(LOG_INFO, "Anim count: %d", PhanimAnimCount());
 
+    char watch_name[256] = {0};
+    int watch_fd = argc > 1 ? watch_scene(argv[1], watch_name, sizeof(watch_name)) : -1;
+    if (argc > 1 && watch_fd < 0) TraceLog(LOG_WARNING, "Couldn't watch '%s' for changes", argv[1]);
+
     bool pause = true;
     while (!WindowShouldClose()) {
+        if (watch_fd >= 0 && scene_changed(watch_fd, watch_name) && PhanimReloadScene(argv[1])) {
+            PhanimPrepareTex();
+        }
         if (IsKeyPressed(KEY_SPACE)) {
             pause = !pause;
         }
+        if (IsKeyPressed(KEY_LEFT)) {
+            PhanimSeek(PhanimGetTime() - 1.0f);
+        }
+        if (IsKeyPressed(KEY_RIGHT)) {
+            PhanimSeek(PhanimGetTime() + 1.0f);
+        }
+        if (IsKeyPressed(KEY_F3)) {
+            PhanimSetProfiling(!PhanimIsProfiling());
+        }
 
         BeginDrawing();
         ClearBackground(PhanimGetBackground());
@@ -46,15 +168,25 @@ int main(void)
                 .height = tbh,
             };
             DrawRectangleRec(time_bar, LIGHTGRAY);
+            // Scrub by clicking or dragging anywhere near the timeline
+            Rectangle scrub_area = { time_bar.x, time_bar.y - 10.0f, time_bar.width, time_bar.height + 20.0f };
+            if (IsMouseButtonDown(MOUSE_BUTTON_LEFT) && CheckCollisionPointRec(GetMousePosition(), scrub_area)) {
+                float progress = (GetMousePosition().x - time_bar.x) / time_bar.width;
+                PhanimSeek(progress * PhanimTotalAnimTime());
+            }
             Vector2 center = {
                 time_bar.x + tbw * (PhanimGetTime() / PhanimTotalAnimTime()),
                 time_bar.y + (time_bar.height / 2.0f)
             };
             DrawCircleV(center, tbh, RED);
 
+            if (PhanimIsProfiling()) draw_profile(GetScreenWidth() - 310, 10);
+
         EndDrawing();
+        PhanimProfileFrameEnd();
     }
 
+    if (watch_fd >= 0) close(watch_fd);
     PhanimDeinit();
     CloseWindow();
     return 0;
@@ -1,11 +1,22 @@
 #include "raylib.h"
 #include "raymath.h"
+#include "rlgl.h"
 #include "resvg.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdatomic.h>
 #include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
 #include <unistd.h>
 
 // TODOs
-//   [ ] Add a mechanism to group animations
+//   [x] Add a mechanism to group animations
 //   [ ] Improve smooth interpolations
 //   [ ] Add video rendering feature
 //   [ ] Implement mouse position to screen unit (for debugging)
@@ -22,70 +33,548 @@
 //   [ ] Link an animation to an object via an object's id
 //   [ ] When loading a texture, raylib spams the stdout with 'texture loaded!' logging.
 //       Find a way to remove or stop it.
-//   [ ] *POTENTIAL IMPROVMENT*: For tex objects, find a way to prepare all the svg's before
+//   [x] *POTENTIAL IMPROVMENT*: For tex objects, find a way to prepare all the svg's before
 //       hand so that it isn't done on every frame.
 //   [ ] If an object is added to the list and isn't renderable, should it be required that
 //       it's added(PhanimAddObject) first or can it immediately be added and animated??
 
 #define ARENA_IMPLEMENTATION
 #include "phanim.h"
+#define PHANIM_RASTER_IMPLEMENTATION
+#include "phraster.h"
+#define PHANIM_KERNELS_IMPLEMENTATION
+#include "phkernels.h"
+#define PHANIM_LEXER_IMPLEMENTATION
+#include "phlexer.h"
 
 #define DEFAULT_INIT_CAP 10
 #define DEFAULT_LINE_THICKNESS 3.0f
 #define DEFAULT_FONT_SIZE 25.0f
+#define DEFAULT_TEX_SCALE 1.0f
+// The CPU backend splits the framebuffer into square tiles that are rasterized in parallel
+#define RASTER_TILE_SIZE 64
+// Shapes the raylib backend's batch holds before it has to grow
+#define SHAPE_BATCH_INIT_CAP 1024
+// Circles drawn without the batch are tessellated with 8 << lod segments, lod being
+// picked so no point of the edge is further than CIRCLE_MAX_ERROR pixels from the
+// polygon
+#define CIRCLE_LOD_COUNT 8
+#define CIRCLE_MAX_ERROR 0.25f
+// Culling grid: cells of CULL_CELL_SIZE units hashed into CULL_BUCKETS buckets. Objects
+// covering more than CULL_MAX_CELLS cells are drawn every frame instead.
+#define CULL_CELL_SIZE 256.0f
+#define CULL_BUCKETS 4096
+#define CULL_MAX_CELLS 16
+// Frames in a row objects have to stay unchanged before they're added to the static layer
+#define STATIC_LAYER_SETTLE 8
+// GL_COLOR_BUFFER_BIT, which rlgl doesn't define
+#define STATIC_LAYER_BLIT_MASK 0x00004000
+// Frames of profiling history, 5 seconds at 60 fps
+#define PROFILE_HISTORY 300
 #define LATEX_OUT_DIR "./build/"
-#define LATEX_TEX_FILE LATEX_OUT_DIR"input.tex"
-#define LATEX_DVI_FILE LATEX_OUT_DIR"input.dvi"
-#define LATEX_SVG_FILE LATEX_OUT_DIR"output.svg"
+// Compiled SVGs are kept across runs, one set of files per tex hash
+#define LATEX_CACHE_DIR LATEX_OUT_DIR"tex-cache/"
+
+// Anims that belong to the same group all start at the same time
+#define PHANIM_NO_GROUP ((size_t) -1)
+// Pauses and immediate anims don't change any property, so they have no slot
+#define PHANIM_NO_SLOT ((size_t) -1)
 
-// TODO: add a group id to group anims that should happen at the same time
 typedef struct {
     size_t id, obj_id;
-    void *ptr;
-    void *start;
-    void *target;
+    size_t group;
+    // Index of the anim's values in the track of its `val_type`
+    size_t slot;
     AnimValType val_type;
     AnimKind kind;
-    float anim_time;
     float duration;
     InterpFunc func;
 } Anim;
 
+// Anims refer to the property they drive by its byte offset into `CORE.objs`, i.e.
+// the object's index and the field's offset inside of it. Unlike a pointer, this stays
+// valid when the object array grows and gets moved.
+typedef size_t ObjField;
+#define obj_field(id, member) ((id) * sizeof(Object) + offsetof(Object, member))
+#define obj_field_ptr(T, field) ((T *)((char *)CORE.objs + (field)))
+
+// Start and target values of every anim of one value type, indexed by `Anim.slot`
+#define ANIM_TRACK(T) struct {  \
+    T *start, *target;          \
+    ObjField *dst;              \
+    size_t count, capacity;     \
+}
+
+// Anims of one value type that are currently playing. Everything needed to update
+// them is copied in when they start, so the update is a tight loop over packed arrays.
+#define ANIM_LANES(T) struct {  \
+    size_t *anim;               \
+    float *begin, *duration;    \
+    InterpFunc *func;           \
+    T *start, *target;          \
+    ObjField *dst;              \
+    float *t;                   \
+    T *value;                   \
+    size_t count, capacity;     \
+}
+
+typedef ANIM_TRACK(float) FloatTrack;
+typedef ANIM_TRACK(Vector2) Vec2Track;
+typedef ANIM_TRACK(Color) ColorTrack;
+typedef ANIM_LANES(float) FloatLanes;
+typedef ANIM_LANES(Vector2) Vec2Lanes;
+typedef ANIM_LANES(Color) ColorLanes;
+
+// Compiled scene file, written by PhanimSaveScene() and mapped by PhanimLoadScene().
+// The tables are stored exactly as they are laid out in memory, so a loaded scene is
+// used in place and nothing is parsed. Every table starts at a 16 byte aligned offset
+// from the beginning of the file:
+//   - objs:    `obj_count` Objects in their initial state. Tex objects store the
+//              offset of their source in the string pool instead of a pointer
+//   - texes:   indices of the tex objects, the only ones that need fixing up
+//   - anims:   `anim_count` Anims followed by their start times
+//   - tracks:  start, target and field of every float, Vector2 and Color anim value
+//   - strings: NUL terminated tex sources
+#define PHANIM_SCENE_MAGIC "PHSCENE"
+#define PHANIM_SCENE_VERSION 1
+#define PHANIM_SCENE_BYTE_ORDER 0x01020304u
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    // Layout the file was written with, it's only usable by a build with the same one
+    uint32_t object_size, anim_size;
+    uint64_t file_size;
+    Color background;
+    uint32_t group_count;
+    uint64_t obj_count, tex_count, anim_count;
+    uint64_t float_count, vec2_count, color_count;
+    uint64_t objs, texes, anims, anim_starts;
+    uint64_t float_start, float_target, float_dst;
+    uint64_t vec2_start, vec2_target, vec2_dst;
+    uint64_t color_start, color_target, color_dst;
+    uint64_t strings, strings_size;
+} SceneHeader;
+
+// State of PhanimLoadSceneText()
+typedef struct {
+    PhanimLexer lexer;
+    // The parser never needs more than one token of lookahead
+    PhanimToken tok;
+    const char *path;
+    // Runtime id of every id used in the file, SIZE_MAX for unused ones
+    size_t *ids;
+    // Position and color of every object after the actions read so far, which is
+    // where FadeIn, FadeOut and the swaps start from
+    Vector2 *pos;
+    Color *color;
+    size_t id_count;
+} SceneParser;
+
+// A number, a parenthesized tuple of up to 4 numbers or a string
+typedef struct {
+    PhanimToken tok;
+    int count;
+    float v[4];
+} SceneValue;
+
+// Object while its fields are read. Fields it doesn't list keep the defaults of its kind.
+typedef struct {
+    ObjKind kind;
+    float id;
+    Vector2 a, b;
+    float width, height, radius, stroke_width, font_size;
+    float fill[4], stroke[4];
+    PhanimToken text;
+} SceneObject;
+
+typedef struct {
+    uint64_t hash;
+    // What the hash was computed from, compared on lookup since hashes can collide. The
+    // compiled SVG only depends on the text, each entry is one rasterization of it.
+    char *text;
+    size_t text_len;
+    float scale;
+    Texture texture;
+    Image image;
+} TexCacheEntry;
+
+// Every animated property sampled once per frame by PhanimBake(). Frame `i` is
+// `frame_size` bytes at `frames + i*frame_size`: the id of the current anim, then the
+// values of `fields` (all floats, then all Vector2s, then all Colors).
+typedef struct {
+    float fps;
+    size_t frame_count, frame_size;
+    ObjField *fields;
+    size_t float_count, vec2_count, color_count;
+    // First frame each object is rendered in, SIZE_MAX if it never is
+    size_t *render_from;
+    u8 *frames;
+    // Set once every frame is recorded, updating and seeking use the frames from then on
+    bool ready;
+} Bake;
+
+// Workers for the CPU backend. Each frame, every thread (the caller included) keeps
+// claiming the next unrasterized tile until all of them are done. A tile is only ever
+// drawn by one thread and always in object order, so the output doesn't depend on
+// the number of threads.
+typedef struct {
+    pthread_t *threads;
+    size_t thread_count;
+    pthread_mutex_t lock;
+    pthread_cond_t wake, idle;
+    size_t generation;
+    size_t busy;
+    bool quit;
+    atomic_size_t next_tile;
+} RasterPool;
+
+// One shape of the raylib backend's batch. Every shape is drawn as a box with rounded
+// corners: circles are boxes whose corner radius is half their size and lines are
+// boxes rotated along their direction.
+typedef struct {
+    Vector2 center;
+    Vector2 half_size;
+    // Direction of the box's x axis
+    Vector2 axis;
+    float radius;
+    Color color;
+    // Outline centered on the shape's edge, drawn over it in the same pass
+    float stroke_width;
+    Color stroke_color;
+} ShapeInstance;
+
+// Shapes drawn by the raylib backend since the last tex object, drawn with one
+// instanced draw call of an SDF shader. `failed` is set when instancing isn't
+// available, in which case every object is drawn on its own.
+typedef struct {
+    bool ready, failed;
+    unsigned int shader, vao, quad_vbo, instance_vbo;
+    int mvp_loc;
+    ShapeInstance *items;
+    size_t count, capacity;
+    // Instances the buffer on the GPU has room for
+    size_t gpu_capacity;
+    // Unit circles tessellated for each LOD, made the first time they're needed
+    Vector2 *circle_lods[CIRCLE_LOD_COUNT];
+} ShapeBatch;
+
+// Objects touched since the last frame was rendered: created, or one of their
+// properties changed. `all` means every object has to be looked at again (after
+// seeking or loading a scene) and `list` isn't kept up to date.
+typedef struct {
+    u8 *flags;
+    size_t *list;
+    size_t count, capacity;
+    bool all;
+} Touched;
+
+typedef enum {
+    CULL_NONE,
+    CULL_CELLS,
+    CULL_BIG,
+} CullSlot;
+
+typedef struct {
+    size_t *items;
+    size_t count, capacity;
+} CullBucket;
+
+// Coarse grid over the scene that rendering culls with. Every object that can be seen
+// (rendered and not fully transparent) is listed in the bucket of each cell its bounds
+// overlap, or in `big`. Only touched objects are moved.
+typedef struct {
+    CullBucket *buckets;
+    CullBucket big;
+    // Per object: where it's listed, the bounds and cells it was listed with, and the
+    // last query that looked at it
+    u8 *slots;
+    Rectangle *bounds;
+    PhanimClip *cells;
+    uint32_t *seen;
+    uint32_t query;
+    size_t capacity;
+    // Objects that survived culling this frame, in object order
+    size_t *visible;
+    size_t visible_count;
+} CullGrid;
+
+typedef enum {
+    LAYER_OFF,
+    // Draw the objects before `split`, then save the result as the new layer
+    LAYER_BUILD,
+    // Start from the layer and only draw the objects from `split` on
+    LAYER_REUSE,
+} LayerPass;
+
+// Pixels of the frame after drawing every object before `split`, which is the first
+// object that changed recently. Objects are drawn in order, so as long as none of the
+// objects before `split` changes, frames can start from a copy of the layer.
+typedef struct {
+    bool valid, failed;
+    LayerPass pass;
+    size_t split;
+    // Frames in a row in which nothing before `pending` changed, while `split` came
+    // before it
+    size_t settle, pending;
+    // What the layer was drawn for, any change throws it away
+    int width, height;
+    unsigned target;
+    Matrix mvp;
+    Color background;
+    // CPU backend
+    Color *pixels;
+    // raylib backend
+    unsigned fbo, texture, shader, vao;
+    int texture_width, texture_height;
+    int layer_loc;
+} StaticLayer;
+
+// Time spent in the phase `phase` since `since`, for code that moves from one phase to
+// the next without returning, like the render loop going from one object kind to the
+// next. `phase` is -1 when no phase is being timed.
+typedef struct {
+    int phase;
+    uint64_t since;
+} ProfileRun;
+
+typedef struct {
+    bool enabled;
+    // Nanoseconds per phase of the frame being measured. Rasterizer threads add to them
+    // concurrently.
+    atomic_uint_fast64_t current[PP_COUNT];
+    uint64_t last_frame_end;
+    // Render phase of the main thread, which tex rasterization pauses
+    ProfileRun run;
+    // Milliseconds per phase of the last PROFILE_HISTORY frames, `next` is the oldest
+    float history[PROFILE_HISTORY][PP_COUNT];
+    size_t next, count;
+    int dump_fd;
+    bool dump_json;
+} Profile;
+
 typedef struct {
     // Miscellaneous
-    Arena obj_arena, anim_arena, temp_arena;
+    Arena obj_arena, anim_arena, temp_arena, tex_arena;
     float time;
     Color background;
+    // Rendering
+    RenderBackend backend;
+    PhanimCanvas canvas;
+    RasterPool pool;
+    size_t render_threads;
+    ShapeBatch batch;
+    Touched touched;
+    CullGrid cull;
+    StaticLayer layer;
+    bool layer_enabled;
+    // Objects binned per tile for the current frame. The objects of tile `i` are
+    // `tile_objs[tile_starts[i]..tile_starts[i + 1]]`.
+    size_t tile_cols, tile_rows;
+    size_t *tile_starts, *tile_objs;
     // Anims
     Anim *anims;
     size_t anim_count, anim_capacity;
     size_t anim_current;
     bool completed;
+    // Start time of every anim and the end of the last one, kept up to date as anims
+    // are added or edited. Start times never decrease.
+    float *anim_starts;
+    float total_time;
+    // Where the next anim starts. While a group is open this stays at the group's
+    // start and `group_end` tracks the end of its longest anim.
+    float cursor, group_end;
+    size_t group_id, group_count;
+    bool in_group;
+    // Anim values per type, and the ones that have started but not finished yet
+    FloatTrack float_track;
+    Vec2Track vec2_track;
+    ColorTrack color_track;
+    FloatLanes float_lanes;
+    Vec2Lanes vec2_lanes;
+    ColorLanes color_lanes;
+    // Playing anims without a value (pauses and immediate anims), in id order
+    size_t *active;
+    size_t active_count;
+    // Frames sampled by PhanimBake()
+    Bake bake;
     // Objects
     Object *objs;
+    // State of every object as it was created, which seeking rebuilds the scene from
+    Object *base_objs;
     size_t obj_count, obj_capacity;
-    // SVG stuff
-    resvg_render_tree *svg_tree;
-    u8 *svg_img_data;
-    size_t svg_width, svg_height;
+    // Mappings of the scene file loaded with PhanimLoadScene(), `objs` points into the
+    // first one and `base_objs` into the second
+    void *scene_maps[2];
+    size_t scene_size;
+    // Tex cache (one texture per unique tex source). It outlives the scene, so reloaded
+    // scenes only rasterize the sources they didn't have before.
+    TexCacheEntry *tex_cache;
+    size_t tex_count, tex_capacity;
+    // Profiling
+    Profile profile;
 } Phanim;
 
 static Phanim CORE = {0};
 
+#define arena_grow(a, ptr, old_cap, new_cap) \
+    ((ptr) = arena_realloc((a), (ptr), (old_cap) * sizeof(*(ptr)), (new_cap) * sizeof(*(ptr))))
+
+#define anim_lanes_grow(lanes, old_cap, new_cap)                                    \
+    do {                                                                            \
+        arena_grow(&CORE.anim_arena, (lanes)->anim, old_cap, new_cap);              \
+        arena_grow(&CORE.anim_arena, (lanes)->begin, old_cap, new_cap);             \
+        arena_grow(&CORE.anim_arena, (lanes)->duration, old_cap, new_cap);          \
+        arena_grow(&CORE.anim_arena, (lanes)->func, old_cap, new_cap);              \
+        arena_grow(&CORE.anim_arena, (lanes)->start, old_cap, new_cap);             \
+        arena_grow(&CORE.anim_arena, (lanes)->target, old_cap, new_cap);            \
+        arena_grow(&CORE.anim_arena, (lanes)->dst, old_cap, new_cap);               \
+        arena_grow(&CORE.anim_arena, (lanes)->t, old_cap, new_cap);                 \
+        arena_grow(&CORE.anim_arena, (lanes)->value, old_cap, new_cap);             \
+        (lanes)->capacity = (new_cap);                                              \
+    } while (0)
+
+// Grows every array of a track, and the lanes of the same type along with it (they
+// can never hold more anims than the track)
+#define anim_track_reserve(track, lanes)                                            \
+    do {                                                                            \
+        if ((track)->count >= (track)->capacity) {                                  \
+            size_t old_cap = (track)->capacity;                                     \
+            size_t new_cap = old_cap == 0 ? DEFAULT_INIT_CAP : old_cap*2;           \
+            arena_grow(&CORE.anim_arena, (track)->start, old_cap, new_cap);         \
+            arena_grow(&CORE.anim_arena, (track)->target, old_cap, new_cap);        \
+            arena_grow(&CORE.anim_arena, (track)->dst, old_cap, new_cap);           \
+            (track)->capacity = new_cap;                                            \
+            anim_lanes_grow(lanes, old_cap, new_cap);                               \
+        }                                                                           \
+    } while (0)
+
+#define anim_track_add(track, lanes, dst_field, start_val, target_val) \
+    do {                                                             \
+        anim_track_reserve(track, lanes);                            \
+        (track)->start[(track)->count] = (start_val);                \
+        (track)->target[(track)->count] = (target_val);              \
+        (track)->dst[(track)->count] = (dst_field);                  \
+        (track)->count++;                                            \
+    } while (0)
+
+// Copies the values of anim `a` from its track into the next lane
+#define anim_lanes_push(lanes, track, a)                                \
+    do {                                                                \
+        size_t lane = (lanes)->count++;                                 \
+        (lanes)->anim[lane] = (a)->id;                                  \
+        (lanes)->begin[lane] = CORE.anim_starts[(a)->id];               \
+        (lanes)->duration[lane] = (a)->duration;                        \
+        (lanes)->func[lane] = (a)->func;                                \
+        (lanes)->start[lane] = (track)->start[(a)->slot];               \
+        (lanes)->target[lane] = (track)->target[(a)->slot];             \
+        (lanes)->dst[lane] = (track)->dst[(a)->slot];                   \
+    } while (0)
+
+#define anim_lanes_move(lanes, to, from)                    \
+    do {                                                    \
+        (lanes)->anim[to] = (lanes)->anim[from];            \
+        (lanes)->begin[to] = (lanes)->begin[from];          \
+        (lanes)->duration[to] = (lanes)->duration[from];    \
+        (lanes)->func[to] = (lanes)->func[from];            \
+        (lanes)->start[to] = (lanes)->start[from];          \
+        (lanes)->target[to] = (lanes)->target[from];        \
+        (lanes)->dst[to] = (lanes)->dst[from];              \
+    } while (0)
+
 static float rate_func(InterpFunc func, float anim_time, float duration);
 static size_t phanim_add_anim(Anim anim);
 static size_t phanim_add_obj(Object obj);
-static float *phanim_dfloat(float val);
-static Vector2 *phanim_dvec2(Vector2 val);
-static Color *phanim_dcolor(Color val);
+static void anim_apply(Anim *a, float anim_time);
+static void anim_start(Anim *a);
+static void update_float_lanes(FloatLanes *l, float time);
+static void update_vec2_lanes(Vec2Lanes *l, float time);
+static void update_color_lanes(ColorLanes *l, float time);
+static void timeline_rebuild(size_t from);
+static size_t bake_unique_fields(ObjField *fields, const ObjField *src, size_t count);
+static void bake_record(size_t frame);
+static void bake_apply(float time);
+static void bake_drop(void);
+static uint64_t scene_align(uint64_t offset);
+static bool scene_write(FILE *f, uint64_t *offset, const void *data, size_t size);
+static bool scene_table_ok(uint64_t offset, uint64_t count, size_t size, uint64_t file_size);
+static bool scene_validate(const SceneHeader *h, size_t file_size);
+static bool scene_error(SceneParser *p, PhanimToken tok, const char *fmt, ...);
+static void scene_next(SceneParser *p);
+static bool scene_token_is(PhanimToken tok, const char *text);
+static bool scene_expect(SceneParser *p, char punct);
+static bool scene_parse_value(SceneParser *p, SceneValue *value);
+static Color scene_color(const float *v);
+static bool scene_parse_object(SceneParser *p);
+static bool scene_object_id(SceneParser *p, SceneValue *value, size_t *file_id);
+static bool scene_animatable(SceneParser *p, SceneValue *value, size_t obj);
+static bool scene_parse_action(SceneParser *p);
+static void scene_exchange(Phanim *other);
+static void scene_free(Phanim *scene);
+static bool object_equal(const Object *a, const Object *b);
+static bool anim_values_equal(const Phanim *sa, const Anim *a, const Phanim *sb, const Anim *b);
+static void scene_diff(const Phanim *old, size_t *objs_changed, size_t *anims_changed);
+static size_t float_track_add(ObjField dst, float start, float target);
+static size_t vec2_track_add(ObjField dst, Vector2 start, Vector2 target);
+static size_t color_track_add(ObjField dst, Color start, Color target);
 static void anim_print(Anim *a);
 static void assert_id(size_t id, bool is_anim);
-static size_t make_anim(size_t id, void *ptr, void *start, void *target, AnimValType val_type, AnimKind kind, float duration);
+static size_t make_anim(size_t id, AnimValType val_type, size_t slot, AnimKind kind, float duration);
 static bool compile_latex(
     const char *tex_file, const char *out_dir,
     const char *dvi_file, const char *svg_file);
-static void latex_to_svg(TexData *tex);
-static void render_svg(Vector2 pos);
+static const char *latex_source(TexData *tex);
+static bool latex_write_source(TexData *tex, const char *tex_file);
+static bool latex_cache_valid(TexData *tex, uint64_t hash);
+static const char *latex_cache_path(uint64_t hash, const char *ext);
+static bool latex_compile_cached(TexData *tex, uint64_t hash);
+static Image latex_to_svg(TexData *tex, uint64_t hash);
+static uint64_t tex_hash(TexData *tex);
+static TexCacheEntry *tex_cache_get(TexData *tex);
+static Rectangle object_bounds(Object *o);
+static void obj_touch(size_t id);
+static void obj_touch_all(void);
+static bool object_visible(Object *o);
+static Matrix render_mvp(void);
+static Rectangle render_view(void);
+static size_t cull_bucket(int cx, int cy);
+static void cull_bucket_remove(CullBucket *bucket, size_t id);
+static void cull_bucket_push(CullBucket *bucket, size_t id);
+static void cull_remove(size_t id);
+static void cull_insert(size_t id);
+static size_t cull_update(void);
+static size_t cull_query(Rectangle view);
+static void cull_free(void);
+static LayerPass static_layer_plan(size_t first_changed, int width, int height, unsigned target, Matrix mvp);
+static void static_layer_copy_tile(Color *dst, const Color *src, PhanimClip clip);
+static bool static_layer_load_gl(int width, int height);
+static void static_layer_capture_gl(void);
+static void static_layer_restore_gl(void);
+static void static_layer_unload(void);
+static void draw_object_cpu(PhanimClip clip, Object *o);
+static void raster_tiles(void);
+static void *raster_worker(void *arg);
+static void raster_pool_start(void);
+static void raster_pool_stop(void);
+static void render_cpu(void);
+static void draw_object_immediate(Object *o);
+static const Vector2 *circle_lod(float radius, size_t *segments);
+static void draw_circle_immediate(CircleData *c);
+static bool shape_batch_init(void);
+static void shape_batch_reserve_gpu(size_t capacity);
+static void shape_batch_push(Object *o);
+static void shape_batch_flush(void);
+static void shape_batch_unload(void);
+static uint64_t profile_now(void);
+static uint64_t profile_begin(void);
+static void profile_end(PhanimPhase phase, uint64_t start);
+static void profile_run_switch(ProfileRun *run, int phase);
+static int profile_compare(const void *a, const void *b);
+#ifdef ARENA_STATS
+static Arena *arena_of(PhanimArena arena);
+#endif // ARENA_STATS
+static void arena_log_stats(void);
 
 static bool compile_latex(
     const char *tex_file, const char *out_dir,
@@ -96,11 +585,11 @@ static bool compile_latex(
     snprintf(
         cmd, BUF_LEN,
         "pdflatex -draftmode -interaction=nonstopmode -output-format=dvi"
-        " -output-directory=%s %s", out_dir, tex_file
+        " -output-directory=%s %s > /dev/null", out_dir, tex_file
     );
     TraceLog(LOG_INFO, "Executed commmand: %s\n", cmd);
     int ret = system(cmd);
-    if (ret == 0) return false;
+    if (ret != 0) return false;
 
     memset(cmd, 0, sizeof(cmd));
     snprintf(
@@ -108,8 +597,8 @@ static bool compile_latex(
         "dvisvgm -n -v 0 --output=%s %s", svg_file, dvi_file
     );
     TraceLog(LOG_INFO, "Executed commmand: %s\n", cmd);
-    system(cmd);
-    if (ret == 0) return false;
+    ret = system(cmd);
+    if (ret != 0) return false;
 
     return true;
 }
@@ -122,70 +611,225 @@ const char *TEX_HEADER =
     "\\thispagestyle{empty}\n\n"
     "\\begin{document}\n";
 
-static void latex_to_svg(TexData *tex)
+// The whole LaTeX document for a tex object, in the temp arena
+static const char *latex_source(TexData *tex)
+{
+    return arena_sprintf(
+        &CORE.temp_arena, "%s\\begin{align*}\n%.*s\\end{align*}\n\\end{document}\n",
+        TEX_HEADER, (int)tex->text.count, tex->text.text
+    );
+}
+
+static bool latex_write_source(TexData *tex, const char *tex_file)
+{
+    const char *source = latex_source(tex);
+    size_t size = strlen(source);
+    FILE *f = fopen(tex_file, "w");
+    if (f == NULL) {
+        TraceLog(LOG_WARNING, "Failed to open '%s': %s", tex_file, strerror(errno));
+        return false;
+    }
+    bool ok = fwrite(source, 1, size, f) == size;
+    fclose(f);
+    return ok;
+}
+
+// Whether there is a cached SVG for `hash` that was compiled from this object's source.
+// The source is kept next to it, so a hash collision compiles the object again instead
+// of showing another formula.
+static bool latex_cache_valid(TexData *tex, uint64_t hash)
+{
+    if (access(latex_cache_path(hash, ".svg"), F_OK) != 0) return false;
+    FILE *f = fopen(latex_cache_path(hash, ".tex"), "rb");
+    if (f == NULL) return false;
+
+    const char *source = latex_source(tex);
+    size_t size = strlen(source);
+    char *cached = arena_alloc(&CORE.temp_arena, size + 1);
+    // Reading one byte more than expected catches cached sources that are longer
+    bool equal = fread(cached, 1, size + 1, f) == size && memcmp(cached, source, size) == 0;
+    fclose(f);
+    return equal;
+}
+
+static const char *latex_cache_path(uint64_t hash, const char *ext)
 {
-    PhanimStr str;
-    PhanimStrInit(&str, TEX_HEADER);
-    PhanimStrAppend(&str, "\\begin{align*}\n");
-    PhanimStrConcat(&str, &tex->text);
-    PhanimStrAppend(&str, "\\end{align*}\n");
+    return arena_sprintf(&CORE.temp_arena, LATEX_CACHE_DIR"%016llx%s", (unsigned long long)hash, ext);
+}
 
-    // TODO: Save to file here!!
+static bool latex_compile_cached(TexData *tex, uint64_t hash)
+{
+    // Every intermediate file is named after the hash, so any number of these can run
+    // at once. The SVG is written under a temporary name and renamed at the end so that
+    // another process never picks up a half written file.
+    const char *tex_file = latex_cache_path(hash, ".tex");
+    const char *dvi_file = latex_cache_path(hash, ".dvi");
+    const char *tmp_file = latex_cache_path(hash, ".svg.tmp");
+    const char *svg_file = latex_cache_path(hash, ".svg");
+
+    if (!latex_write_source(tex, tex_file)) return false;
+    if (!compile_latex(tex_file, LATEX_CACHE_DIR, dvi_file, tmp_file)) return false;
+    return rename(tmp_file, svg_file) == 0;
+}
 
-    // if (!compile_latex(LATEX_TEX_FILE, LATEX_OUT_DIR, LATEX_DVI_FILE, LATEX_SVG_FILE)) {
-    //     PHANIM_WARN("Failed to compile latex");
-    //     return;
-    // }
+static Image latex_to_svg(TexData *tex, uint64_t hash)
+{
+    const char *svg_file = latex_cache_path(hash, ".svg");
+    if (!latex_cache_valid(tex, hash)) {
+        // Wasn't compiled ahead of time by PhanimPrepareTex()
+        mkdir(LATEX_OUT_DIR, 0755);
+        mkdir(LATEX_CACHE_DIR, 0755);
+        if (!latex_compile_cached(tex, hash)) {
+            PHANIM_WARN("Failed to compile latex");
+        }
+    }
 
     resvg_options *opt = resvg_options_create();
     resvg_options_load_system_fonts(opt);
 
-    int err = resvg_parse_tree_from_file(LATEX_SVG_FILE, opt, &CORE.svg_tree);
+    resvg_render_tree *tree = NULL;
+    int err = resvg_parse_tree_from_file(svg_file, opt, &tree);
+    resvg_options_destroy(opt);
     if (err != RESVG_OK) {
         PHANIM_WARN("SVG rendering doesn't work!");
     }
 
-    resvg_size size = resvg_get_image_size(CORE.svg_tree);
-    int factor = 1;
-    int width = (int)size.width * factor;
-    int height = (int)size.height * factor;
+    resvg_size size = resvg_get_image_size(tree);
+    float factor = tex->scale;
+    int width = (int)(size.width * factor);
+    int height = (int)(size.height * factor);
 
-    CORE.svg_img_data = arena_alloc(&CORE.temp_arena, width * height * sizeof(int));
-    CORE.svg_width = width;
-    CORE.svg_height = height;
+    // The pixels only live until they are uploaded to the GPU, so the caller is
+    // expected to rewind the temp arena afterwards
+    Image img = {
+        .data = arena_alloc(&CORE.temp_arena, width * height * sizeof(int)),
+        .width = width,
+        .height = height,
+        .mipmaps = 1,
+        .format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8,
+    };
+    memset(img.data, 0, width * height * sizeof(int));
 
     resvg_transform transform = { 0 };
-    transform.a = (float) factor;
-    transform.d = (float) factor;
+    transform.a = factor;
+    transform.d = factor;
 
-    resvg_render(CORE.svg_tree, transform, width, height, (char*)CORE.svg_img_data);
-    resvg_tree_destroy(CORE.svg_tree);
+    resvg_render(tree, transform, width, height, (char*)img.data);
+    resvg_tree_destroy(tree);
+    return img;
 }
 
-static void render_svg(Vector2 pos)
+static uint64_t tex_hash(TexData *tex)
 {
-    Image img = {
-        .data = CORE.svg_img_data,
-        .width = CORE.svg_width,
-        .height = CORE.svg_height,
-        .mipmaps = 1,
-        .format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8,
+    // FNV-1a over the tex source, the only thing the generated LaTeX depends on. The
+    // scale is applied when rasterizing, so every scale shares one cached SVG.
+    //   - Source: http://www.isthe.com/chongo/tech/comp/fnv/
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < tex->text.count; i++) {
+        hash = (hash ^ (u8)tex->text.text[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+static TexCacheEntry *tex_cache_get(TexData *tex)
+{
+    uint64_t hash = tex_hash(tex);
+    for (size_t i = 0; i < CORE.tex_count; i++) {
+        TexCacheEntry *e = &CORE.tex_cache[i];
+        if (e->hash == hash && e->text_len == tex->text.count && e->scale == tex->scale
+            && memcmp(e->text, tex->text.text, e->text_len) == 0) {
+            return e;
+        }
+    }
+
+    uint64_t start = profile_begin();
+    Arena_Mark mark = arena_snapshot(&CORE.temp_arena);
+    Image img = latex_to_svg(tex, hash);
+    Texture texture = {0};
+    Image image = {0};
+    if (CORE.backend == RB_CPU) {
+        // The CPU backend draws straight from the pixels, so they have to outlive the temp arena
+        image = img;
+        image.data = arena_memdup(&CORE.tex_arena, img.data, img.width * img.height * sizeof(Color));
+    } else {
+        texture = LoadTextureFromImage(img);
+    }
+    arena_rewind(&CORE.temp_arena, mark);
+
+    if (CORE.tex_count >= CORE.tex_capacity) {
+        size_t new_cap = CORE.tex_capacity == 0 ? DEFAULT_INIT_CAP : CORE.tex_capacity*2;
+        CORE.tex_cache = arena_realloc(&CORE.tex_arena, CORE.tex_cache, CORE.tex_capacity * sizeof(*CORE.tex_cache), new_cap * sizeof(*CORE.tex_cache));
+        CORE.tex_capacity = new_cap;
+    }
+    CORE.tex_cache[CORE.tex_count] = (TexCacheEntry) {
+        .hash = hash,
+        .text = arena_memdup(&CORE.tex_arena, tex->text.text, tex->text.count),
+        .text_len = tex->text.count,
+        .scale = tex->scale,
+        .texture = texture,
+        .image = image,
     };
-    Texture tex = LoadTextureFromImage(img);
-    DrawTextureV(tex, pos, WHITE);
+
+    // Rasterizing happens in the middle of drawing, which shouldn't be charged for it
+    if (start != 0) {
+        uint64_t elapsed = profile_now() - start;
+        atomic_fetch_add(&CORE.profile.current[PP_TEX_RASTER], elapsed);
+        CORE.profile.run.since += elapsed;
+    }
+    return &CORE.tex_cache[CORE.tex_count++];
 }
 
 void PhanimInit(void)
+{
+    PhanimInitEx(RB_RAYLIB, 0, 0);
+}
+
+void PhanimInitEx(RenderBackend backend, int width, int height)
 {
     CORE.anims = NULL;
     CORE.anim_count = 0;
-    CORE.anim_capacity = DEFAULT_INIT_CAP;
+    CORE.anim_capacity = 0;
     CORE.anim_current = 0;
     CORE.completed = false;
+    CORE.anim_starts = NULL;
+    CORE.total_time = 0.0f;
+    CORE.cursor = 0.0f;
+    CORE.group_end = 0.0f;
+    CORE.group_id = PHANIM_NO_GROUP;
+    CORE.group_count = 0;
+    CORE.in_group = false;
+    CORE.float_track = (FloatTrack) {0};
+    CORE.vec2_track = (Vec2Track) {0};
+    CORE.color_track = (ColorTrack) {0};
+    CORE.float_lanes = (FloatLanes) {0};
+    CORE.vec2_lanes = (Vec2Lanes) {0};
+    CORE.color_lanes = (ColorLanes) {0};
+    CORE.active = NULL;
+    CORE.active_count = 0;
+    CORE.bake = (Bake) {0};
     CORE.obj_arena = (Arena) {0};
     CORE.anim_arena = (Arena) {0};
     CORE.temp_arena = (Arena) {0};
+    CORE.tex_arena = (Arena) {0};
     CORE.time = 0.0f;
+    CORE.profile.enabled = false;
+    CORE.profile.run = (ProfileRun) { .phase = -1 };
+    CORE.profile.dump_fd = -1;
+
+    CORE.backend = backend;
+    CORE.batch = (ShapeBatch) {0};
+    CORE.touched = (Touched) { .all = true };
+    CORE.cull = (CullGrid) {0};
+    CORE.layer = (StaticLayer) {0};
+    CORE.layer_enabled = true;
+    CORE.canvas = (PhanimCanvas) {0};
+    if (backend == RB_CPU) {
+        CORE.canvas.width = width;
+        CORE.canvas.height = height;
+        CORE.canvas.pixels = MemAlloc(width * height * sizeof(Color));
+    }
+
+    TraceLog(LOG_INFO, "PHANIM: Using %s interpolation kernels", PhanimKernelsInit());
 
     // Initialize resvg logging library
     resvg_init_log();
@@ -193,9 +837,151 @@ void PhanimInit(void)
 
 void PhanimDeinit(void)
 {
+    for (size_t i = 0; i < CORE.tex_count; i++) {
+        if (CORE.tex_cache[i].texture.id != 0) UnloadTexture(CORE.tex_cache[i].texture);
+    }
+    CORE.tex_cache = NULL;
+    CORE.tex_count = 0;
+    CORE.tex_capacity = 0;
+
+    bake_drop();
+    arena_log_stats();
     arena_free(&CORE.obj_arena);
     arena_free(&CORE.anim_arena);
     arena_free(&CORE.temp_arena);
+    arena_free(&CORE.tex_arena);
+
+    for (size_t i = 0; i < 2; i++) {
+        if (CORE.scene_maps[i] != NULL) munmap(CORE.scene_maps[i], CORE.scene_size);
+        CORE.scene_maps[i] = NULL;
+    }
+
+    raster_pool_stop();
+    shape_batch_unload();
+    cull_free();
+    static_layer_unload();
+    MemFree(CORE.canvas.pixels);
+    CORE.canvas = (PhanimCanvas) {0};
+
+    if (CORE.profile.dump_fd >= 0) close(CORE.profile.dump_fd);
+    CORE.profile.dump_fd = -1;
+}
+
+void PhanimSetRenderThreads(size_t count)
+{
+    // Takes effect the next time the pool is started
+    raster_pool_stop();
+    CORE.render_threads = count;
+}
+
+void PhanimSetStaticLayer(bool enabled)
+{
+    CORE.layer_enabled = enabled;
+    CORE.layer.valid = false;
+}
+
+RenderBackend PhanimGetBackend(void)
+{
+    return CORE.backend;
+}
+
+Color *PhanimGetFramebuffer(void)
+{
+    return CORE.canvas.pixels;
+}
+
+void PhanimPrepareTex(void)
+{
+    uint64_t start = profile_begin();
+    Arena_Mark mark = arena_snapshot(&CORE.temp_arena);
+
+    // Collect every unique tex source that doesn't have a cached SVG yet
+    size_t pending_count = 0;
+    size_t *pending = arena_alloc(&CORE.temp_arena, (CORE.obj_count + 1) * sizeof(*pending));
+    uint64_t *hashes = arena_alloc(&CORE.temp_arena, (CORE.obj_count + 1) * sizeof(*hashes));
+    for (size_t i = 0; i < CORE.obj_count; i++) {
+        if (CORE.objs[i].kind != OK_TEX) continue;
+        uint64_t hash = tex_hash(&CORE.objs[i].tex);
+
+        bool seen = false;
+        for (size_t j = 0; j < pending_count && !seen; j++) {
+            seen = hashes[j] == hash;
+        }
+        if (seen || latex_cache_valid(&CORE.objs[i].tex, hash)) continue;
+
+        pending[pending_count] = i;
+        hashes[pending_count] = hash;
+        pending_count++;
+    }
+
+    if (pending_count > 0) {
+        mkdir(LATEX_OUT_DIR, 0755);
+        mkdir(LATEX_CACHE_DIR, 0755);
+
+        long max_workers = sysconf(_SC_NPROCESSORS_ONLN);
+        if (max_workers < 1) max_workers = 1;
+        TraceLog(LOG_INFO, "Compiling %zu tex object(s) using %ld worker(s)", pending_count, max_workers);
+
+        // Each worker is a forked process that compiles a single tex source and exits.
+        // Only these pids are ever waited on, the process may have other children
+        // (an encoder, export workers) that aren't ours to reap.
+        pid_t *workers = arena_alloc(&CORE.temp_arena, (size_t)max_workers * sizeof(*workers));
+        size_t next = 0, running = 0, failed = 0;
+        while (next < pending_count || running > 0) {
+            if (next < pending_count && running < (size_t)max_workers) {
+                pid_t pid = fork();
+                if (pid == 0) {
+                    bool ok = latex_compile_cached(&CORE.objs[pending[next]].tex, hashes[next]);
+                    _exit(ok ? 0 : 1);
+                } else if (pid > 0) {
+                    next++;
+                    workers[running++] = pid;
+                    continue;
+                }
+                TraceLog(LOG_WARNING, "fork() failed: %s", strerror(errno));
+                if (running == 0) {
+                    // Nothing to wait on, so compile it in this process
+                    if (!latex_compile_cached(&CORE.objs[pending[next]].tex, hashes[next])) failed++;
+                    next++;
+                    continue;
+                }
+            }
+
+            // Reap whichever worker is done, or wait for the oldest one if none is
+            int status = 0;
+            size_t done = running;
+            for (size_t w = 0; w < running && done == running; w++) {
+                if (waitpid(workers[w], &status, WNOHANG) == workers[w]) done = w;
+            }
+            if (done == running) {
+                done = 0;
+                pid_t ret;
+                while ((ret = waitpid(workers[0], &status, 0)) < 0 && errno == EINTR) {}
+                if (ret < 0) status = -1;
+            }
+            workers[done] = workers[--running];
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) failed++;
+        }
+
+        if (failed > 0) {
+            TraceLog(LOG_WARNING, "Failed to compile %zu tex object(s)", failed);
+        }
+    }
+    arena_rewind(&CORE.temp_arena, mark);
+    profile_end(PP_TEX_RASTER, start);
+
+    // Rasterize everything now, instead of on the first frame each object is visible
+    if (CORE.backend == RB_CPU || IsWindowReady()) {
+        for (size_t i = 0; i < CORE.obj_count; i++) {
+            TexData *tex = &CORE.objs[i].tex;
+            if (CORE.objs[i].kind == OK_TEX && tex->texture.id == 0 && tex->image.data == NULL) {
+                TexCacheEntry *entry = tex_cache_get(tex);
+                tex->texture = entry->texture;
+                tex->image = entry->image;
+                obj_touch(i);
+            }
+        }
+    }
 }
 
 float PhanimGetTime(void)
@@ -220,28 +1006,85 @@ Color PhanimGetBackground(void)
 
 void PhanimSetBackground(Color color)
 {
+    Color bg = CORE.background;
+    if (bg.r != color.r || bg.g != color.g || bg.b != color.b || bg.a != color.a) obj_touch_all();
     CORE.background = color;
 }
 
 float PhanimTotalAnimTime(void)
 {
-    float total = 0.0f;
-    for (size_t i = 0; i < CORE.anim_count; i++) {
-        Anim *a = &CORE.anims[i];
-        total += a->duration;
+    return CORE.total_time;
+}
+
+size_t PhanimAnimAtTime(float time)
+{
+    // Binary search for the last anim that has started at `time`
+    size_t lo = 0, hi = CORE.anim_count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (CORE.anim_starts[mid] <= time) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
     }
-    return total;
+    return lo > 0 ? lo - 1 : 0;
+}
+
+float PhanimAnimStartTime(size_t id)
+{
+    assert_id(id, true);
+    return CORE.anim_starts[id];
 }
 
 void PhanimChangeInterpFunc(size_t id, InterpFunc func)
 {
     assert_id(id, true);
+    bake_drop();
     CORE.anims[id].func = func;
+    if (CORE.anim_current > id) {
+        // Playing anims keep their own copy of the function
+        PhanimSeek(CORE.time);
+    }
+}
+
+void PhanimChangeDuration(size_t id, float duration)
+{
+    assert_id(id, true);
+    bake_drop();
+    CORE.anims[id].duration = duration;
+    timeline_rebuild(id);
+    if (CORE.anim_current > 0) {
+        // Start times after `id` moved, so the active set has to be rebuilt
+        PhanimSeek(CORE.time);
+    }
+}
+
+void PhanimBeginGroup(void)
+{
+    if (CORE.in_group) {
+        TraceLog(LOG_WARNING, "Groups can't be nested, PhanimBeginGroup() ignored");
+        return;
+    }
+    CORE.in_group = true;
+    CORE.group_id = CORE.group_count++;
+    CORE.group_end = CORE.cursor;
+}
+
+void PhanimEndGroup(void)
+{
+    if (!CORE.in_group) {
+        TraceLog(LOG_WARNING, "PhanimEndGroup() called without PhanimBeginGroup()");
+        return;
+    }
+    CORE.in_group = false;
+    CORE.group_id = PHANIM_NO_GROUP;
+    CORE.cursor = CORE.group_end;
 }
 
 void PhanimPause(float duration)
 {
-    make_anim(PHANIM_NO_ANIM, NULL, NULL, NULL, AVT_FLOAT, AK_PAUSE, duration);
+    make_anim(PHANIM_NO_ANIM, AVT_FLOAT, PHANIM_NO_SLOT, AK_PAUSE, duration);
 }
 
 size_t PhanimLine(Vector2 start, Vector2 end, Color color)
@@ -301,12 +1144,26 @@ size_t PhanimCircle(Vector2 center, float radius, Color color)
     return phanim_add_obj(obj);
 }
 
+void PhanimSetStroke(size_t id, float width, Color color)
+{
+    assert_id(id, false);
+    if (CORE.objs[id].kind != OK_CIRCLE) {
+        TraceLog(LOG_WARNING, "PHANIM: Only circles have a stroke");
+        return;
+    }
+    CORE.objs[id].circle.stroke_width = CORE.base_objs[id].circle.stroke_width = width;
+    CORE.objs[id].circle.stroke_color = CORE.base_objs[id].circle.stroke_color = color;
+    obj_touch(id);
+}
+
 size_t PhanimTex(PhanimStr str, Vector2 pos)
 {
     TexData tx = {
         .text = str,
         .position = pos,
         .font_size = DEFAULT_FONT_SIZE,
+        .scale = DEFAULT_TEX_SCALE,
+        .texture = {0},
     };
 
     Object obj = {
@@ -322,19 +1179,18 @@ size_t PhanimTex(PhanimStr str, Vector2 pos)
 void PhanimTransformPos(size_t id, Vector2 start, Vector2 target, float duration)
 {
     assert_id(id, false);
-    Object *obj = &CORE.objs[id];
-    Vector2 *ptr = NULL;
-    switch (obj->kind) {
+    ObjField field = 0;
+    switch (CORE.objs[id].kind) {
         case OK_LINE: {
-            ptr = &obj->line.pos;
+            field = obj_field(id, line.pos);
         } break;
 
         case OK_RECT: {
-            ptr = &obj->rect.pos;
+            field = obj_field(id, rect.pos);
         } break;
 
         case OK_CIRCLE: {
-            ptr = &obj->circle.center;
+            field = obj_field(id, circle.center);
         } break;
 
         default: {
@@ -342,25 +1198,24 @@ void PhanimTransformPos(size_t id, Vector2 start, Vector2 target, float duration
         } break;
     }
 
-    make_anim(id, ptr, phanim_dvec2(start), phanim_dvec2(target), AVT_VEC2, AK_POSITION_TRANSFORM, duration);
+    make_anim(id, AVT_VEC2, vec2_track_add(field, start, target), AK_POSITION_TRANSFORM, duration);
 }
 
 void PhanimFadeColor(size_t id, Color start, Color target, float duration)
 {
     assert_id(id, false);
-    Object *obj = &CORE.objs[id];
-    Color *ptr = NULL;
-    switch (obj->kind) {
+    ObjField field = 0;
+    switch (CORE.objs[id].kind) {
         case OK_LINE: {
-            ptr = &obj->line.color;
+            field = obj_field(id, line.color);
         } break;
 
         case OK_RECT: {
-            ptr = &obj->rect.color;
+            field = obj_field(id, rect.color);
         } break;
 
         case OK_CIRCLE: {
-            ptr = &obj->circle.color;
+            field = obj_field(id, circle.color);
         } break;
 
         default: {
@@ -368,15 +1223,14 @@ void PhanimFadeColor(size_t id, Color start, Color target, float duration)
         } break;
     }
 
-    make_anim(id, ptr, phanim_dcolor(start), phanim_dcolor(target), AVT_COLOR, AK_COLOR_FADE, duration);
+    make_anim(id, AVT_COLOR, color_track_add(field, start, target), AK_COLOR_FADE, duration);
 }
 
 size_t PhanimScaleSizeFloat(size_t id, float start, float target, float duration)
 {
     assert_id(id, false);
-    Object *obj = &CORE.objs[id];
-    float *ptr = NULL;
-    switch (obj->kind) {
+    ObjField field = 0;
+    switch (CORE.objs[id].kind) {
         case OK_RECT:
         case OK_LINE: {
             PHANIM_WARN("Lines and Rects shouldn't be scaled using PhanimScaleSizeFloat()");
@@ -384,7 +1238,7 @@ size_t PhanimScaleSizeFloat(size_t id, float start, float target, float duration
         } break;
 
         case OK_CIRCLE: {
-            ptr = &obj->circle.radius;
+            field = obj_field(id, circle.radius);
         } break;
 
         default: {
@@ -392,21 +1246,20 @@ size_t PhanimScaleSizeFloat(size_t id, float start, float target, float duration
         } break;
     }
 
-    return make_anim(id, ptr, phanim_dfloat(start), phanim_dfloat(target), AVT_FLOAT, AK_SCALE, duration);
+    return make_anim(id, AVT_FLOAT, float_track_add(field, start, target), AK_SCALE, duration);
 }
 
 size_t PhanimScaleSizeVec2(size_t id, Vector2 start, Vector2 target, float duration)
 {
     assert_id(id, false);
-    Object *obj = &CORE.objs[id];
-    Vector2 *ptr = NULL;
-    switch (obj->kind) {
+    ObjField field = 0;
+    switch (CORE.objs[id].kind) {
         case OK_LINE: {
-            ptr = &obj->line.size;
+            field = obj_field(id, line.size);
         } break;
 
         case OK_RECT: {
-            ptr = &obj->rect.size;
+            field = obj_field(id, rect.size);
         } break;
 
         case OK_CIRCLE: {
@@ -419,258 +1272,2726 @@ size_t PhanimScaleSizeVec2(size_t id, Vector2 start, Vector2 target, float durat
         } break;
     }
 
-    return make_anim(id, ptr, phanim_dvec2(start), phanim_dvec2(target), AVT_VEC2, AK_SCALE, duration);
+    return make_anim(id, AVT_VEC2, vec2_track_add(field, start, target), AK_SCALE, duration);
 }
 
 void PhanimAddObject(size_t id)
 {
     // This is a temporary system. This will be changed!
-    make_anim(id, NULL, NULL, NULL, AVT_VEC2, AK_IMMEDIATE, 0.0f);
+    make_anim(id, AVT_VEC2, PHANIM_NO_SLOT, AK_IMMEDIATE, 0.0f);
 }
 
 void PhanimUpdate(float dt)
 {
-    // if (CORE.time >= PhanimTotalAnimTime()) {
-    if (CORE.anim_current >= CORE.anim_count) {
+    if (CORE.completed) {
+        return;
+    }
+    uint64_t start = profile_begin();
+    CORE.time += dt;
+    if (CORE.bake.ready) {
+        bake_apply(CORE.time);
+        profile_end(PP_UPDATE, start);
+        return;
+    }
+
+    // Anims start in id order, so everything that starts this frame comes next
+    while (CORE.anim_current < CORE.anim_count && CORE.anim_starts[CORE.anim_current] <= CORE.time) {
+        anim_start(&CORE.anims[CORE.anim_current]);
+        CORE.anim_current++;
+    }
+
+    // Every anim overlapping the current time advances in the same pass, one tight loop
+    // per value type. Finished ones get their final value applied once more and drop
+    // out of the active set.
+    update_float_lanes(&CORE.float_lanes, CORE.time);
+    update_vec2_lanes(&CORE.vec2_lanes, CORE.time);
+    update_color_lanes(&CORE.color_lanes, CORE.time);
+
+    size_t kept = 0;
+    for (size_t i = 0; i < CORE.active_count; i++) {
+        size_t id = CORE.active[i];
+        if (CORE.time - CORE.anim_starts[id] < CORE.anims[id].duration) {
+            CORE.active[kept++] = id;
+        }
+    }
+    CORE.active_count = kept;
+
+    if (CORE.anim_current >= CORE.anim_count && CORE.active_count == 0 && CORE.float_lanes.count == 0
+        && CORE.vec2_lanes.count == 0 && CORE.color_lanes.count == 0) {
         CORE.completed = true;
+    }
+    profile_end(PP_UPDATE, start);
+}
+
+void PhanimSeek(float time)
+{
+    uint64_t start = profile_begin();
+    float total = PhanimTotalAnimTime();
+    time = Clamp(time, 0.0f, total);
+    if (CORE.bake.ready) {
+        CORE.time = time;
+        bake_apply(time);
+        profile_end(PP_UPDATE, start);
         return;
     }
 
-    Anim *a = &CORE.anims[CORE.anim_current];
-    Object *obj = &CORE.objs[a->obj_id];
-    if (a->kind == AK_IMMEDIATE) {
-        obj->should_render = true;
+    // Every property is rebuilt from the objects' initial state, so seeking backwards
+    // works the same way as seeking forwards. This and replaying the anims below is
+    // linear in the size of the scene, only PhanimAnimAtTime() is a binary search.
+    obj_touch_all();
+    for (size_t i = 0; i < CORE.obj_count; i++) {
+        Object obj = CORE.base_objs[i];
+        if (obj.kind == OK_TEX) {
+            // Keep whatever the tex cache already handed out
+            obj.tex.texture = CORE.objs[i].tex.texture;
+            obj.tex.image = CORE.objs[i].tex.image;
+        }
+        CORE.objs[i] = obj;
     }
-    CORE.time += dt;
-    if (a->anim_time >= a->duration) {
-        CORE.anim_current += 1;
-        if (CORE.anim_current < CORE.anim_count) {
-            a = &CORE.anims[CORE.anim_current];
-            obj = &CORE.objs[a->obj_id];
-        } else {
-            // Here, index will be out of bounds
-            CORE.completed = true;
-            return;
+
+    // Every anim up to the last one that has started is either done or partway
+    // through, the ones after it haven't started yet
+    size_t started = CORE.anim_count > 0 && CORE.anim_starts[0] <= time ? PhanimAnimAtTime(time) + 1 : 0;
+    CORE.active_count = 0;
+    CORE.float_lanes.count = 0;
+    CORE.vec2_lanes.count = 0;
+    CORE.color_lanes.count = 0;
+    for (size_t i = 0; i < started; i++) {
+        Anim *a = &CORE.anims[i];
+        float anim_time = time - CORE.anim_starts[i];
+        if (anim_time < a->duration) {
+            anim_start(a);
+        } else if (a->obj_id != PHANIM_NO_ANIM) {
+            CORE.objs[a->obj_id].should_render = true;
         }
+        anim_apply(a, anim_time);
     }
 
-    if (!obj->should_render) {
-        obj->should_render = true;
+    CORE.time = time;
+    CORE.anim_current = started;
+    CORE.completed = started >= CORE.anim_count && CORE.active_count == 0 && CORE.float_lanes.count == 0
+        && CORE.vec2_lanes.count == 0 && CORE.color_lanes.count == 0;
+    profile_end(PP_UPDATE, start);
+}
+
+void PhanimBake(float fps)
+{
+    bake_drop();
+    if (fps <= 0.0f) {
+        TraceLog(LOG_WARNING, "PHANIM: Can't bake at %.2f fps", fps);
         return;
     }
+    if (CORE.time > 0.0f) PhanimSeek(0.0f);
+
+    // Several anims can drive the same property, it's only stored once per frame
+    Bake *b = &CORE.bake;
+    size_t field_count = CORE.float_track.count + CORE.vec2_track.count + CORE.color_track.count;
+    b->fields = MemAlloc((field_count + 1) * sizeof(*b->fields));
+    b->float_count = bake_unique_fields(b->fields, CORE.float_track.dst, CORE.float_track.count);
+    b->vec2_count = bake_unique_fields(b->fields + b->float_count, CORE.vec2_track.dst, CORE.vec2_track.count);
+    b->color_count = bake_unique_fields(
+        b->fields + b->float_count + b->vec2_count, CORE.color_track.dst, CORE.color_track.count);
+
+    b->fps = fps;
+    b->frame_count = (size_t)ceilf(PhanimTotalAnimTime() * fps) + 2;
+    b->frame_size = sizeof(uint32_t) + b->float_count * sizeof(float)
+        + b->vec2_count * sizeof(Vector2) + b->color_count * sizeof(Color);
+    b->frames = MemAlloc(b->frame_count * b->frame_size);
+    b->render_from = MemAlloc((CORE.obj_count + 1) * sizeof(*b->render_from));
+    for (size_t i = 0; i < CORE.obj_count; i++) {
+        b->render_from[i] = SIZE_MAX;
+    }
 
-    if (a->anim_time < a->duration) {
-        a->anim_time += dt;
+    // Stepped exactly like playback, so the baked frames match what it would produce
+    // at this frame rate
+    size_t frame = 0;
+    bake_record(frame++);
+    while (!CORE.completed && frame < b->frame_count) {
+        PhanimUpdate(1.0f / fps);
+        bake_record(frame++);
     }
-    float t = rate_func(a->func, a->anim_time, a->duration);
+    b->frame_count = frame;
+    b->ready = true;
 
-    switch (a->val_type) {
-        case AVT_VEC2: {
-            Vector2 start = *(Vector2*)a->start;
-            Vector2 *ptr = (Vector2*)a->ptr;
-            Vector2 target = *(Vector2*)a->target;
-            *ptr = Vector2Lerp(start, target, t);
-        } break;
+    CORE.time = 0.0f;
+    bake_apply(0.0f);
+    TraceLog(LOG_INFO, "PHANIM: Baked %zu frames of %zu properties (%zu KB)", b->frame_count,
+        b->float_count + b->vec2_count + b->color_count, b->frame_count * b->frame_size / 1024);
+}
 
-        case AVT_FLOAT: {
-            if (a->ptr == NULL && a->target == NULL) {
-                // Probably, a pause anim
-            } else {
-                float start = *(float*)a->start;
-                float *ptr = (float*)a->ptr;
-                float target = *(float*)a->target;
-                *ptr = Lerp(start, target, t);
-            }
-        } break;
+bool PhanimIsBaked(void)
+{
+    return CORE.bake.ready;
+}
 
-        case AVT_U8: {
-            u8 start = *(u8*)a->start;
-            u8 *ptr = (u8*)a->ptr;
-            u8 target = *(u8*)a->target;
-            u8 result = start + t*(target - start);
-            *ptr = result;
-        } break;
+bool PhanimSaveScene(const char *path)
+{
+    if (CORE.in_group) {
+        TraceLog(LOG_WARNING, "PHANIM: Can't save a scene while a group is open");
+        return false;
+    }
 
-        case AVT_COLOR: {
-            Color start = *(Color*)a->start;
-            Color *ptr = (Color*)a->ptr;
-            Color target = *(Color*)a->target;
-            *ptr = ColorLerp(start, target, t);
-        } break;
+    SceneHeader h = {
+        .version = PHANIM_SCENE_VERSION,
+        .byte_order = PHANIM_SCENE_BYTE_ORDER,
+        .object_size = sizeof(Object),
+        .anim_size = sizeof(Anim),
+        .background = CORE.background,
+        .group_count = (uint32_t)CORE.group_count,
+        .obj_count = CORE.obj_count,
+        .anim_count = CORE.anim_count,
+        .float_count = CORE.float_track.count,
+        .vec2_count = CORE.vec2_track.count,
+        .color_count = CORE.color_track.count,
+    };
+    memcpy(h.magic, PHANIM_SCENE_MAGIC, sizeof(PHANIM_SCENE_MAGIC));
 
-        default: {
-            PHANIM_UNREACHABLE("Unknown anim value type!");
-        } break;
+    // Tex sources move into the string pool, the objects keep their offset in it
+    Arena_Mark mark = arena_snapshot(&CORE.temp_arena);
+    Object *objs = arena_memdup(&CORE.temp_arena, CORE.base_objs, (CORE.obj_count + 1) * sizeof(Object));
+    uint64_t *texes = arena_alloc(&CORE.temp_arena, (CORE.obj_count + 1) * sizeof(*texes));
+    for (size_t i = 0; i < CORE.obj_count; i++) {
+        if (objs[i].kind != OK_TEX) continue;
+        TexData *tex = &objs[i].tex;
+        texes[h.tex_count++] = i;
+        tex->text.text = (char *)(uintptr_t)h.strings_size;
+        tex->text.capacity = tex->text.count + 1;
+        tex->texture = (Texture) {0};
+        tex->image = (Image) {0};
+        h.strings_size += tex->text.count + 1;
+    }
+
+    char *tmp_path = arena_sprintf(&CORE.temp_arena, "%s.tmp", path);
+    FILE *f = fopen(tmp_path, "wb");
+    if (f == NULL) {
+        TraceLog(LOG_WARNING, "PHANIM: Couldn't open '%s': %s", tmp_path, strerror(errno));
+        arena_rewind(&CORE.temp_arena, mark);
+        return false;
+    }
+
+    // The header goes last, once every offset is known
+    uint64_t offset = sizeof(h);
+    bool ok = fseek(f, (long)offset, SEEK_SET) == 0;
+    #define SCENE_TABLE(field, data, size) \
+        do { h.field = scene_align(offset); ok = ok && scene_write(f, &offset, (data), (size)); } while (0)
+    SCENE_TABLE(objs, objs, CORE.obj_count * sizeof(Object));
+    SCENE_TABLE(texes, texes, h.tex_count * sizeof(*texes));
+    SCENE_TABLE(anims, CORE.anims, CORE.anim_count * sizeof(Anim));
+    SCENE_TABLE(anim_starts, CORE.anim_starts, CORE.anim_count * sizeof(float));
+    SCENE_TABLE(float_start, CORE.float_track.start, h.float_count * sizeof(float));
+    SCENE_TABLE(float_target, CORE.float_track.target, h.float_count * sizeof(float));
+    SCENE_TABLE(float_dst, CORE.float_track.dst, h.float_count * sizeof(ObjField));
+    SCENE_TABLE(vec2_start, CORE.vec2_track.start, h.vec2_count * sizeof(Vector2));
+    SCENE_TABLE(vec2_target, CORE.vec2_track.target, h.vec2_count * sizeof(Vector2));
+    SCENE_TABLE(vec2_dst, CORE.vec2_track.dst, h.vec2_count * sizeof(ObjField));
+    SCENE_TABLE(color_start, CORE.color_track.start, h.color_count * sizeof(Color));
+    SCENE_TABLE(color_target, CORE.color_track.target, h.color_count * sizeof(Color));
+    SCENE_TABLE(color_dst, CORE.color_track.dst, h.color_count * sizeof(ObjField));
+    h.strings = scene_align(offset);
+    ok = ok && scene_write(f, &offset, NULL, 0);
+    for (size_t i = 0; i < h.tex_count; i++) {
+        PhanimStr *text = &CORE.base_objs[texes[i]].tex.text;
+        ok = ok && fwrite(text->text, 1, text->count, f) == text->count && fputc('\0', f) != EOF;
+        offset += text->count + 1;
+    }
+    #undef SCENE_TABLE
+    h.file_size = offset;
+
+    ok = ok && fseek(f, 0, SEEK_SET) == 0 && fwrite(&h, sizeof(h), 1, f) == 1;
+    ok = fclose(f) == 0 && ok;
+    ok = ok && rename(tmp_path, path) == 0;
+    if (!ok) {
+        TraceLog(LOG_WARNING, "PHANIM: Couldn't write scene '%s'", path);
+        remove(tmp_path);
     }
+    arena_rewind(&CORE.temp_arena, mark);
+    return ok;
 }
 
-void PhanimRender(void)
+bool PhanimLoadScene(const char *path)
 {
-    for (size_t i = 0; i < CORE.obj_count; i++) {
-        Object *o = &CORE.objs[i];
-        if (!o->should_render) {
-            continue;
-        }
-        switch (o->kind) {
-            case OK_CIRCLE: {
-                CircleData *c = &o->circle;
-                DrawCircleV(c->center, c->radius, c->color);
-            } break;
+    if (CORE.obj_count > 0 || CORE.anim_count > 0) {
+        TraceLog(LOG_WARNING, "PHANIM: A scene can only be loaded into an empty one");
+        return false;
+    }
 
-            case OK_LINE: {
-                LineData *l = &o->line;
-                DrawLineEx(l->pos, Vector2Add(l->pos, l->size), l->thickness, l->color);
-            } break;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        TraceLog(LOG_WARNING, "PHANIM: Couldn't open scene '%s': %s", path, strerror(errno));
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(SceneHeader)) {
+        TraceLog(LOG_WARNING, "PHANIM: '%s' isn't a scene file", path);
+        close(fd);
+        return false;
+    }
 
-            case OK_RECT: {
-                RectData *r = &o->rect;
-                Vector2 top_left = Vector2Subtract(r->pos, Vector2Scale(r->size, 0.5));
-                DrawRectangleV(top_left, r->size, r->color);
-            } break;
+    // Private mappings are copy-on-write: the objects are animated in place and only
+    // the pages that actually change get copied. The second one keeps the initial
+    // state that seeking starts from.
+    size_t size = (size_t)st.st_size;
+    void *maps[2];
+    for (size_t i = 0; i < 2; i++) {
+        maps[i] = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if (maps[0] == MAP_FAILED || maps[1] == MAP_FAILED) {
+        TraceLog(LOG_WARNING, "PHANIM: Couldn't map scene '%s': %s", path, strerror(errno));
+        for (size_t i = 0; i < 2; i++) {
+            if (maps[i] != MAP_FAILED) munmap(maps[i], size);
+        }
+        return false;
+    }
 
-            case OK_TEX: {
-                TexData *tex = &o->tex;
-                latex_to_svg(tex);
-                render_svg(tex->position);
-            } break;
+    const SceneHeader *h = maps[0];
+    if (!scene_validate(h, size)) {
+        TraceLog(LOG_WARNING, "PHANIM: '%s' isn't a valid scene file for this build", path);
+        munmap(maps[0], size);
+        munmap(maps[1], size);
+        return false;
+    }
 
-            default: {
-                PHANIM_UNREACHABLE("Unknown object kind!");
-            } break;
+    #define SCENE_AT(base, field) ((void *)((char *)(base) + h->field))
+    CORE.objs = SCENE_AT(maps[0], objs);
+    CORE.base_objs = SCENE_AT(maps[1], objs);
+    CORE.obj_count = h->obj_count;
+    CORE.obj_capacity = h->obj_count;
+    obj_touch_all();
+    const uint64_t *texes = SCENE_AT(maps[0], texes);
+    for (size_t i = 0; i < h->tex_count; i++) {
+        Object *objs[] = { &CORE.objs[texes[i]], &CORE.base_objs[texes[i]] };
+        for (size_t k = 0; k < 2; k++) {
+            objs[k]->tex.text.text = (char *)maps[k] + h->strings + (uintptr_t)objs[k]->tex.text.text;
+            // Handles and pixels only mean something in the process that made them
+            objs[k]->tex.texture = (Texture) {0};
+            objs[k]->tex.image = (Image) {0};
         }
     }
+
+    CORE.anims = SCENE_AT(maps[0], anims);
+    CORE.anim_starts = SCENE_AT(maps[0], anim_starts);
+    CORE.anim_count = h->anim_count;
+    CORE.anim_capacity = h->anim_count;
+    CORE.active = arena_alloc(&CORE.anim_arena, (h->anim_count + 1) * sizeof(*CORE.active));
+    CORE.group_count = h->group_count;
+
+    // Tracks are used in place, only the lanes of playing anims need memory of their own
+    #define SCENE_TRACK(track, lanes, prefix)                           \
+        do {                                                            \
+            (track)->start = SCENE_AT(maps[0], prefix##_start);         \
+            (track)->target = SCENE_AT(maps[0], prefix##_target);       \
+            (track)->dst = SCENE_AT(maps[0], prefix##_dst);             \
+            (track)->count = (track)->capacity = h->prefix##_count;     \
+            anim_lanes_grow(lanes, 0, (track)->capacity);               \
+        } while (0)
+    SCENE_TRACK(&CORE.float_track, &CORE.float_lanes, float);
+    SCENE_TRACK(&CORE.vec2_track, &CORE.vec2_lanes, vec2);
+    SCENE_TRACK(&CORE.color_track, &CORE.color_lanes, color);
+    #undef SCENE_TRACK
+    #undef SCENE_AT
+
+    CORE.scene_maps[0] = maps[0];
+    CORE.scene_maps[1] = maps[1];
+    CORE.scene_size = size;
+    CORE.background = h->background;
+    CORE.time = 0.0f;
+    CORE.anim_current = 0;
+    CORE.completed = false;
+    timeline_rebuild(0);
+    return true;
 }
 
-static float *phanim_dfloat(float val)
+bool PhanimLoadSceneText(const char *path)
 {
-    return arena_memdup(&CORE.temp_arena, &val, sizeof(float));
+    if (CORE.obj_count > 0 || CORE.anim_count > 0) {
+        TraceLog(LOG_WARNING, "PHANIM: A scene can only be loaded into an empty one");
+        return false;
+    }
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        TraceLog(LOG_WARNING, "PHANIM: Couldn't open scene '%s': %s", path, strerror(errno));
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        TraceLog(LOG_WARNING, "PHANIM: Couldn't stat scene '%s': %s", path, strerror(errno));
+        close(fd);
+        return false;
+    }
+    // The file is tokenized straight from the mapping, nothing is copied
+    size_t size = (size_t)st.st_size;
+    const char *src = size > 0 ? mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0) : "";
+    close(fd);
+    if (src == MAP_FAILED) {
+        TraceLog(LOG_WARNING, "PHANIM: Couldn't map scene '%s': %s", path, strerror(errno));
+        return false;
+    }
+    if (size > 0) madvise((void *)src, size, MADV_SEQUENTIAL);
+
+    // The scene is built into a fresh one, so a parse error doesn't leave half of it
+    // behind
+    Phanim empty = { .group_id = PHANIM_NO_GROUP, .background = CORE.background };
+    scene_exchange(&empty);
+    Arena_Mark mark = arena_snapshot(&CORE.temp_arena);
+    SceneParser p = { .path = path };
+    PhanimLexerInit(&p.lexer, src, size);
+    scene_next(&p);
+
+    // Objects come first, until a section marker says otherwise
+    bool ok = true;
+    bool actions = false;
+    while (ok && p.tok.kind != PHANIM_TOKEN_EOF) {
+        if (p.tok.kind == PHANIM_TOKEN_SECTION) {
+            if (scene_token_is(p.tok, "DATA_SECTION")) actions = false;
+            else if (scene_token_is(p.tok, "ACTION_SECTION")) actions = true;
+            else ok = scene_error(&p, p.tok, "Unknown section '%%%.*s%%'", (int)p.tok.len, p.tok.text);
+            scene_next(&p);
+        } else {
+            ok = actions ? scene_parse_action(&p) : scene_parse_object(&p);
+        }
+    }
+
+    arena_rewind(&CORE.temp_arena, mark);
+    if (size > 0) munmap((void *)src, size);
+    if (!ok) {
+        scene_exchange(&empty);
+        // The objects built before the error were touched
+        obj_touch_all();
+    }
+    scene_free(&empty);
+    return ok;
 }
 
-static Vector2 *phanim_dvec2(Vector2 val)
+bool PhanimReloadScene(const char *path)
 {
-    return arena_memdup(&CORE.temp_arena, &val, sizeof(Vector2));
+    // The new scene is built next to the current one, which is only dropped once the
+    // new one loaded without errors
+    Phanim old = { .group_id = PHANIM_NO_GROUP, .background = CORE.background };
+    scene_exchange(&old);
+    bool ok = IsFileExtension(path, ".phanim") ? PhanimLoadSceneText(path) : PhanimLoadScene(path);
+    // Loading touched objects of the new scene, which isn't necessarily the one that
+    // stays, so rendering has to look at every object again
+    obj_touch_all();
+    if (!ok) {
+        scene_exchange(&old);
+        scene_free(&old);
+        return false;
+    }
+
+    size_t objs_changed = 0, anims_changed = 0;
+    scene_diff(&old, &objs_changed, &anims_changed);
+    if (objs_changed == 0 && anims_changed == 0) {
+        // Saving without changes shouldn't disturb playback or drop the baked frames
+        scene_exchange(&old);
+        scene_free(&old);
+        TraceLog(LOG_INFO, "PHANIM: Reloaded '%s', nothing changed", path);
+        return true;
+    }
+
+    float time = old.time;
+    float bake_fps = old.bake.ready ? old.bake.fps : 0.0f;
+    scene_free(&old);
+    TraceLog(
+        LOG_INFO, "PHANIM: Reloaded '%s', %zu object(s) and %zu anim(s) changed",
+        path, objs_changed, anims_changed
+    );
+    if (bake_fps > 0.0f) PhanimBake(bake_fps);
+    PhanimSeek(fminf(time, CORE.total_time));
+    return true;
 }
 
-static Color *phanim_dcolor(Color val)
+void PhanimSetProfiling(bool enabled)
 {
-    return arena_memdup(&CORE.temp_arena, &val, sizeof(Color));
+    Profile *p = &CORE.profile;
+    for (size_t i = 0; i < PP_COUNT; i++) {
+        atomic_store(&p->current[i], 0);
+    }
+    p->last_frame_end = 0;
+    p->run = (ProfileRun) { .phase = -1 };
+    p->enabled = enabled;
 }
 
-static size_t make_anim(size_t id, void *ptr, void *start, void *target, AnimValType val_type, AnimKind kind, float duration)
+bool PhanimIsProfiling(void)
 {
-    Anim a = {
-        .id = CORE.anim_count,
-        .obj_id = id,
-        .ptr = ptr,
-        .start = start,
-        .target = target,
-        .val_type = val_type,
-        .kind = kind,
-        .anim_time = 0.0,
-        .duration = duration,
-        .func = RF_CUBIC_SMOOTH_STEP
-    };
+    return CORE.profile.enabled;
+}
 
-    return phanim_add_anim(a);
+void PhanimProfileAdd(PhanimPhase phase, double seconds)
+{
+    if (!CORE.profile.enabled || seconds <= 0.0) return;
+    atomic_fetch_add(&CORE.profile.current[phase], (uint64_t)(seconds * 1e9));
 }
 
-static size_t phanim_add_anim(Anim anim)
+void PhanimProfileFrameEnd(void)
 {
-    if (CORE.anim_count >= CORE.anim_capacity) {
-        size_t new_cap = CORE.anim_capacity == 0 ? DEFAULT_INIT_CAP : CORE.anim_capacity*2;
-        CORE.anims = arena_realloc(&CORE.anim_arena, CORE.anims, CORE.anim_capacity * sizeof(*CORE.anims), new_cap * sizeof(*CORE.anims));
-        CORE.anim_capacity = new_cap;
-    }
+    Profile *p = &CORE.profile;
+    if (!p->enabled) return;
 
-    size_t ind = CORE.anim_count;
-    CORE.anims[ind] = anim;
-    CORE.anim_count++;
+    uint64_t now = profile_now();
+    atomic_store(&p->current[PP_FRAME], p->last_frame_end != 0 ? now - p->last_frame_end : 0);
+    p->last_frame_end = now;
+
+    float *row = p->history[p->next];
+    for (size_t i = 0; i < PP_COUNT; i++) {
+        row[i] = (float)atomic_exchange(&p->current[i], 0) * 1e-6f;
+    }
+    p->next = (p->next + 1) % PROFILE_HISTORY;
+    if (p->count < PROFILE_HISTORY) p->count++;
+
+    if (p->dump_fd < 0) return;
+    // One write() per line, so lines from forked workers never interleave
+    char line[512];
+    int len = snprintf(line, sizeof(line), p->dump_json ? "{\"time\":%.4f" : "%.4f", CORE.time);
+    for (size_t i = 0; i < PP_COUNT; i++) {
+        if (p->dump_json) len += snprintf(line + len, sizeof(line) - len, ",\"%s\":%.4f", PhanimPhaseName(i), row[i]);
+        else len += snprintf(line + len, sizeof(line) - len, ",%.4f", row[i]);
+    }
+    len += snprintf(line + len, sizeof(line) - len, p->dump_json ? "}\n" : "\n");
+    if (write(p->dump_fd, line, len) != len) {
+        TraceLog(LOG_WARNING, "PHANIM: Couldn't write profile: %s", strerror(errno));
+        close(p->dump_fd);
+        p->dump_fd = -1;
+    }
+}
+
+bool PhanimProfileDump(const char *path)
+{
+    Profile *p = &CORE.profile;
+    if (p->dump_fd >= 0) close(p->dump_fd);
+    p->dump_fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+    if (p->dump_fd < 0) {
+        TraceLog(LOG_WARNING, "PHANIM: Couldn't open '%s': %s", path, strerror(errno));
+        return false;
+    }
+    p->dump_json = IsFileExtension(path, ".json");
+    if (!p->dump_json) {
+        char header[256];
+        int len = snprintf(header, sizeof(header), "time");
+        for (size_t i = 0; i < PP_COUNT; i++) {
+            len += snprintf(header + len, sizeof(header) - len, ",%s", PhanimPhaseName(i));
+        }
+        len += snprintf(header + len, sizeof(header) - len, "\n");
+        if (write(p->dump_fd, header, len) != len) return false;
+    }
+    return true;
+}
+
+const char *PhanimPhaseName(PhanimPhase phase)
+{
+    static const char *names[PP_COUNT] = {
+        [PP_UPDATE] = "update",
+        [PP_RENDER_LINE] = "render_line",
+        [PP_RENDER_RECT] = "render_rect",
+        [PP_RENDER_CIRCLE] = "render_circle",
+        [PP_RENDER_TEX] = "render_tex",
+        [PP_RENDER_BIN] = "render_bin",
+        [PP_TEX_RASTER] = "tex_raster",
+        [PP_READBACK] = "readback",
+        [PP_ENCODE] = "encode",
+        [PP_FRAME] = "frame",
+    };
+    return phase < PP_COUNT ? names[phase] : "unknown";
+}
+
+size_t PhanimProfileFrameCount(void)
+{
+    return CORE.profile.count;
+}
+
+float PhanimProfileGet(PhanimPhase phase, size_t ago)
+{
+    Profile *p = &CORE.profile;
+    if (ago >= p->count) return 0.0f;
+    return p->history[(p->next + PROFILE_HISTORY - 1 - ago) % PROFILE_HISTORY][phase];
+}
+
+float PhanimProfilePercentile(PhanimPhase phase, float p)
+{
+    size_t count = CORE.profile.count;
+    if (count == 0) return 0.0f;
+    float values[PROFILE_HISTORY];
+    for (size_t i = 0; i < count; i++) {
+        values[i] = CORE.profile.history[i][phase];
+    }
+    qsort(values, count, sizeof(*values), profile_compare);
+    // Nearest rank
+    size_t rank = (size_t)ceilf(Clamp(p, 0.0f, 100.0f) / 100.0f * (float)count);
+    return values[rank > 0 ? rank - 1 : 0];
+}
+
+bool PhanimArenaStats(PhanimArena arena, Arena_Stats *stats)
+{
+#ifdef ARENA_STATS
+    Arena *a = arena_of(arena);
+    if (a == NULL) return false;
+    *stats = arena_stats(a);
+    return true;
+#else
+    PHANIM_UNUSED(arena);
+    PHANIM_UNUSED(stats);
+    return false;
+#endif // ARENA_STATS
+}
+
+const char *PhanimArenaName(PhanimArena arena)
+{
+    static const char *names[PA_COUNT] = {
+        [PA_OBJ] = "obj",
+        [PA_ANIM] = "anim",
+        [PA_TEMP] = "temp",
+        [PA_TEX] = "tex",
+        [PA_STR] = "str",
+    };
+    return arena < PA_COUNT ? names[arena] : "unknown";
+}
+
+bool PhanimFrameChanged(void)
+{
+    // Objects are only touched when one of their properties really changed
+    return CORE.touched.all || CORE.touched.count > 0;
+}
+
+void PhanimRender(void)
+{
+    if (CORE.backend == RB_CPU) {
+        render_cpu();
+        return;
+    }
+
+    bool batched = shape_batch_init();
+    profile_run_switch(&CORE.profile.run, PP_RENDER_BIN);
+    size_t first_changed = cull_update();
+    size_t visible = cull_query(render_view());
+
+    // The layer is copied with framebuffer blits, which need OpenGL 3.3 like batching
+    LayerPass pass = LAYER_OFF;
+    int width = rlGetFramebufferWidth(), height = rlGetFramebufferHeight();
+    if (batched) pass = static_layer_plan(first_changed, width, height, rlGetActiveFramebuffer(), render_mvp());
+    if (pass != LAYER_OFF && !static_layer_load_gl(width, height)) pass = LAYER_OFF;
+    size_t split = CORE.layer.split, k = 0;
+    if (pass == LAYER_REUSE) {
+        static_layer_restore_gl();
+        while (k < visible && CORE.cull.visible[k] < split) k++;
+    }
+
+    for (; k < visible; k++) {
+        Object *o = &CORE.objs[CORE.cull.visible[k]];
+        if (pass == LAYER_BUILD && CORE.cull.visible[k] >= split) {
+            shape_batch_flush();
+            static_layer_capture_gl();
+            pass = LAYER_REUSE;
+        }
+        if (batched && o->kind != OK_TEX) {
+            profile_run_switch(&CORE.profile.run, PP_RENDER_LINE + o->kind);
+            shape_batch_push(o);
+            continue;
+        }
+        // Tex objects are drawn by raylib, so the shapes batched before them go first
+        if (batched) shape_batch_flush();
+        profile_run_switch(&CORE.profile.run, PP_RENDER_LINE + o->kind);
+        draw_object_immediate(o);
+    }
+    if (batched) shape_batch_flush();
+    if (pass == LAYER_BUILD) static_layer_capture_gl();
+    profile_run_switch(&CORE.profile.run, -1);
+}
+
+static void draw_object_immediate(Object *o)
+{
+    switch (o->kind) {
+        case OK_CIRCLE: {
+            draw_circle_immediate(&o->circle);
+        } break;
+
+        case OK_LINE: {
+            LineData *l = &o->line;
+            DrawLineEx(l->pos, Vector2Add(l->pos, l->size), l->thickness, l->color);
+        } break;
+
+        case OK_RECT: {
+            RectData *r = &o->rect;
+            Vector2 top_left = Vector2Subtract(r->pos, Vector2Scale(r->size, 0.5));
+            DrawRectangleV(top_left, r->size, r->color);
+        } break;
+
+        case OK_TEX: {
+            TexData *tex = &o->tex;
+            if (tex->texture.id == 0) {
+                tex->texture = tex_cache_get(tex)->texture;
+                // Its size is known now, so it can be culled like everything else
+                obj_touch((size_t)(o - CORE.objs));
+            }
+            DrawTextureV(tex->texture, tex->position, WHITE);
+        } break;
+
+        default: {
+            PHANIM_UNREACHABLE("Unknown object kind!");
+        } break;
+    }
+}
+
+// Unit circle with enough segments for a circle of `radius` pixels
+static const Vector2 *circle_lod(float radius, size_t *segments)
+{
+    // A chord of a circle with n segments is at most r*(1 - cos(pi/n)) away from the edge
+    size_t lod = 0;
+    while (lod + 1 < CIRCLE_LOD_COUNT && radius * (1.0f - cosf(PI / (float)(8 << lod))) > CIRCLE_MAX_ERROR) lod++;
+
+    *segments = (size_t)8 << lod;
+    Vector2 **points = &CORE.batch.circle_lods[lod];
+    if (*points == NULL) {
+        *points = MemAlloc((*segments + 1) * sizeof(Vector2));
+        for (size_t i = 0; i <= *segments; i++) {
+            float angle = 2.0f * PI * (float)i / (float)*segments;
+            (*points)[i] = (Vector2){ cosf(angle), sinf(angle) };
+        }
+    }
+    return *points;
+}
+
+// Fill and stroke in one go, with as many segments as the circle's size on screen needs
+static void draw_circle_immediate(CircleData *c)
+{
+    if (c->radius <= 0.0f) return;
+    Matrix m = MatrixMultiply(rlGetMatrixTransform(), rlGetMatrixModelview());
+    float scale = Vector2Length((Vector2){ m.m0, m.m1 });
+    float half = c->stroke_width > 0.0f && c->stroke_color.a > 0 ? 0.5f * c->stroke_width : 0.0f;
+
+    size_t n = 0;
+    const Vector2 *unit = circle_lod((c->radius + half) * scale, &n);
+    Vector2 o = c->center;
+    rlCheckRenderBatchLimit((int)(9 * n));
+    rlBegin(RL_TRIANGLES);
+    if (c->color.a > 0) {
+        rlColor4ub(c->color.r, c->color.g, c->color.b, c->color.a);
+        float r = c->radius;
+        for (size_t i = 0; i < n; i++) {
+            rlVertex2f(o.x, o.y);
+            rlVertex2f(o.x + unit[i + 1].x * r, o.y + unit[i + 1].y * r);
+            rlVertex2f(o.x + unit[i].x * r, o.y + unit[i].y * r);
+        }
+    }
+    if (half > 0.0f) {
+        rlColor4ub(c->stroke_color.r, c->stroke_color.g, c->stroke_color.b, c->stroke_color.a);
+        float inner = fmaxf(c->radius - half, 0.0f), outer = c->radius + half;
+        for (size_t i = 0; i < n; i++) {
+            Vector2 a = unit[i], b = unit[i + 1];
+            rlVertex2f(o.x + a.x * outer, o.y + a.y * outer);
+            rlVertex2f(o.x + a.x * inner, o.y + a.y * inner);
+            rlVertex2f(o.x + b.x * inner, o.y + b.y * inner);
+
+            rlVertex2f(o.x + b.x * inner, o.y + b.y * inner);
+            rlVertex2f(o.x + b.x * outer, o.y + b.y * outer);
+            rlVertex2f(o.x + a.x * outer, o.y + a.y * outer);
+        }
+    }
+    rlEnd();
+}
+
+static const char *SHAPE_VS =
+    "#version 330\n"
+    "in vec2 corner;\n"
+    "in vec2 center;\n"
+    "in vec2 halfSize;\n"
+    "in vec2 axis;\n"
+    "in float radius;\n"
+    "in vec4 color;\n"
+    "in float strokeWidth;\n"
+    "in vec4 strokeColor;\n"
+    "uniform mat4 mvp;\n"
+    "out vec2 fragLocal;\n"
+    "out vec2 fragHalfSize;\n"
+    "out float fragRadius;\n"
+    "out vec4 fragColor;\n"
+    "out float fragStrokeWidth;\n"
+    "out vec4 fragStrokeColor;\n"
+    "void main()\n"
+    "{\n"
+    // Padded by half the stroke and a unit for the anti-aliased edge
+    "    fragLocal = corner*(halfSize + 0.5*strokeWidth + 1.0);\n"
+    "    fragHalfSize = halfSize;\n"
+    "    fragRadius = radius;\n"
+    "    fragColor = color;\n"
+    "    fragStrokeWidth = strokeWidth;\n"
+    "    fragStrokeColor = strokeColor;\n"
+    "    vec2 pos = center + axis*fragLocal.x + vec2(-axis.y, axis.x)*fragLocal.y;\n"
+    "    gl_Position = mvp*vec4(pos, 0.0, 1.0);\n"
+    "}\n";
+
+static const char *SHAPE_FS =
+    "#version 330\n"
+    "in vec2 fragLocal;\n"
+    "in vec2 fragHalfSize;\n"
+    "in float fragRadius;\n"
+    "in vec4 fragColor;\n"
+    "in float fragStrokeWidth;\n"
+    "in vec4 fragStrokeColor;\n"
+    "out vec4 finalColor;\n"
+    "void main()\n"
+    "{\n"
+    "    vec2 q = abs(fragLocal) - fragHalfSize + fragRadius;\n"
+    "    float d = length(max(q, 0.0)) + min(max(q.x, q.y), 0.0) - fragRadius;\n"
+    // Same coverage as the CPU rasterizer, with the distance measured in pixels
+    "    float unit = length(dFdx(fragLocal));\n"
+    "    float fill = fragColor.a*clamp(0.5 - d/unit, 0.0, 1.0);\n"
+    "    float stroke = fragStrokeColor.a*clamp(0.5 - (abs(d) - 0.5*fragStrokeWidth)/unit, 0.0, 1.0);\n"
+    "    if (fragStrokeWidth <= 0.0) stroke = 0.0;\n"
+    // The stroke blended over the fill
+    "    float alpha = stroke + fill*(1.0 - stroke);\n"
+    "    if (alpha <= 0.0) discard;\n"
+    "    finalColor = vec4((fragStrokeColor.rgb*stroke + fragColor.rgb*fill*(1.0 - stroke))/alpha, alpha);\n"
+    "}\n";
+
+static bool shape_batch_init(void)
+{
+    ShapeBatch *b = &CORE.batch;
+    if (b->ready || b->failed) return b->ready;
+
+    int version = rlGetVersion();
+    if (version != RL_OPENGL_33 && version != RL_OPENGL_43) {
+        TraceLog(LOG_WARNING, "PHANIM: Batching needs OpenGL 3.3, drawing objects one by one");
+        b->failed = true;
+        return false;
+    }
+    b->shader = rlLoadShaderCode(SHAPE_VS, SHAPE_FS);
+    if (b->shader == 0 || b->shader == rlGetShaderIdDefault()) {
+        TraceLog(LOG_WARNING, "PHANIM: Failed to load the shape shader, drawing objects one by one");
+        b->shader = 0;
+        b->failed = true;
+        return false;
+    }
+    b->mvp_loc = rlGetLocationUniform(b->shader, "mvp");
+
+    // Two triangles covering [-1, 1]x[-1, 1], which the vertex shader fits to each shape.
+    // Wound like raylib's quads so back-face culling keeps them.
+    static const float corners[] = { -1, -1, -1, 1, 1, 1, -1, -1, 1, 1, 1, -1 };
+    b->vao = rlLoadVertexArray();
+    rlEnableVertexArray(b->vao);
+    b->quad_vbo = rlLoadVertexBuffer(corners, sizeof(corners), false);
+    int corner_loc = rlGetLocationAttrib(b->shader, "corner");
+    rlSetVertexAttribute(corner_loc, 2, RL_FLOAT, false, 0, 0);
+    rlEnableVertexAttribute(corner_loc);
+    shape_batch_reserve_gpu(SHAPE_BATCH_INIT_CAP);
+    rlDisableVertexArray();
+
+    b->capacity = SHAPE_BATCH_INIT_CAP;
+    b->items = MemAlloc(b->capacity * sizeof(*b->items));
+    b->count = 0;
+    b->ready = true;
+    return true;
+}
+
+// Recreates the instance buffer with room for `capacity` shapes, expects the batch's
+// vertex array to be bound
+static void shape_batch_reserve_gpu(size_t capacity)
+{
+    ShapeBatch *b = &CORE.batch;
+    if (b->instance_vbo != 0) rlUnloadVertexBuffer(b->instance_vbo);
+    b->instance_vbo = rlLoadVertexBuffer(NULL, capacity * sizeof(ShapeInstance), true);
+    b->gpu_capacity = capacity;
+
+    static const struct {
+        const char *name;
+        int size, type;
+        bool normalized;
+        size_t offset;
+    } attribs[] = {
+        { "center", 2, RL_FLOAT, false, offsetof(ShapeInstance, center) },
+        { "halfSize", 2, RL_FLOAT, false, offsetof(ShapeInstance, half_size) },
+        { "axis", 2, RL_FLOAT, false, offsetof(ShapeInstance, axis) },
+        { "radius", 1, RL_FLOAT, false, offsetof(ShapeInstance, radius) },
+        { "color", 4, RL_UNSIGNED_BYTE, true, offsetof(ShapeInstance, color) },
+        { "strokeWidth", 1, RL_FLOAT, false, offsetof(ShapeInstance, stroke_width) },
+        { "strokeColor", 4, RL_UNSIGNED_BYTE, true, offsetof(ShapeInstance, stroke_color) },
+    };
+    for (size_t i = 0; i < sizeof(attribs) / sizeof(attribs[0]); i++) {
+        int loc = rlGetLocationAttrib(b->shader, attribs[i].name);
+        if (loc < 0) continue;
+        rlSetVertexAttribute(loc, attribs[i].size, attribs[i].type, attribs[i].normalized, sizeof(ShapeInstance), (int)attribs[i].offset);
+        rlEnableVertexAttribute(loc);
+        rlSetVertexAttributeDivisor(loc, 1);
+    }
+}
+
+static void shape_batch_push(Object *o)
+{
+    ShapeInstance s = { .axis = { 1.0f, 0.0f } };
+    switch (o->kind) {
+        case OK_CIRCLE: {
+            CircleData *c = &o->circle;
+            if (c->radius <= 0.0f) return;
+            s.center = c->center;
+            s.half_size = (Vector2){ c->radius, c->radius };
+            s.radius = c->radius;
+            s.color = c->color;
+            if (c->stroke_width > 0.0f) {
+                s.stroke_width = c->stroke_width;
+                s.stroke_color = c->stroke_color;
+            }
+        } break;
+
+        case OK_LINE: {
+            LineData *l = &o->line;
+            float length = Vector2Length(l->size);
+            if (length <= 0.0f || l->thickness <= 0.0f) return;
+            s.center = Vector2Add(l->pos, Vector2Scale(l->size, 0.5f));
+            s.half_size = (Vector2){ 0.5f*length, 0.5f*l->thickness };
+            s.axis = Vector2Scale(l->size, 1.0f/length);
+            s.color = l->color;
+        } break;
+
+        case OK_RECT: {
+            RectData *r = &o->rect;
+            if (r->size.x <= 0.0f || r->size.y <= 0.0f) return;
+            s.center = r->pos;
+            s.half_size = Vector2Scale(r->size, 0.5f);
+            s.color = r->color;
+        } break;
+
+        default: {
+            PHANIM_UNREACHABLE("Only shapes are batched!");
+        } break;
+    }
+    if (s.color.a == 0 && s.stroke_color.a == 0) return;
+
+    ShapeBatch *b = &CORE.batch;
+    if (b->count >= b->capacity) {
+        b->capacity *= 2;
+        b->items = MemRealloc(b->items, b->capacity * sizeof(*b->items));
+    }
+    b->items[b->count++] = s;
+}
+
+static void shape_batch_flush(void)
+{
+    ShapeBatch *b = &CORE.batch;
+    if (b->count == 0) return;
+    profile_run_switch(&CORE.profile.run, PP_RENDER_BIN);
+
+    // Whatever raylib batched so far was drawn first
+    rlDrawRenderBatchActive();
+
+    rlEnableVertexArray(b->vao);
+    if (b->count > b->gpu_capacity) shape_batch_reserve_gpu(b->capacity);
+    rlUpdateVertexBuffer(b->instance_vbo, b->items, (int)(b->count * sizeof(ShapeInstance)), 0);
+
+    rlEnableShader(b->shader);
+    rlSetUniformMatrix(b->mvp_loc, render_mvp());
+    rlDrawVertexArrayInstanced(0, 6, (int)b->count);
+    rlDisableShader();
+    rlDisableVertexArray();
+    b->count = 0;
+}
+
+static void shape_batch_unload(void)
+{
+    ShapeBatch *b = &CORE.batch;
+    if (b->ready) {
+        rlUnloadShaderProgram(b->shader);
+        rlUnloadVertexBuffer(b->quad_vbo);
+        rlUnloadVertexBuffer(b->instance_vbo);
+        rlUnloadVertexArray(b->vao);
+    }
+    MemFree(b->items);
+    for (size_t i = 0; i < CIRCLE_LOD_COUNT; i++) {
+        MemFree(b->circle_lods[i]);
+    }
+    *b = (ShapeBatch) {0};
+}
+
+static Rectangle object_bounds(Object *o)
+{
+    // Everything is padded by a pixel to account for anti-aliasing
+    switch (o->kind) {
+        case OK_CIRCLE: {
+            CircleData *c = &o->circle;
+            float r = c->radius + fmaxf(0.5f*c->stroke_width, 0.0f) + 1.0f;
+            return (Rectangle){ c->center.x - r, c->center.y - r, 2.0f*r, 2.0f*r };
+        } break;
+
+        case OK_LINE: {
+            LineData *l = &o->line;
+            Vector2 end = Vector2Add(l->pos, l->size);
+            float pad = 0.5f*l->thickness + 1.0f;
+            float x0 = fminf(l->pos.x, end.x) - pad, y0 = fminf(l->pos.y, end.y) - pad;
+            float x1 = fmaxf(l->pos.x, end.x) + pad, y1 = fmaxf(l->pos.y, end.y) + pad;
+            return (Rectangle){ x0, y0, x1 - x0, y1 - y0 };
+        } break;
+
+        case OK_RECT: {
+            RectData *r = &o->rect;
+            return (Rectangle){
+                r->pos.x - 0.5f*r->size.x - 1.0f, r->pos.y - 0.5f*r->size.y - 1.0f,
+                r->size.x + 2.0f, r->size.y + 2.0f
+            };
+        } break;
+
+        case OK_TEX: {
+            // The raylib backend only ever fills in the texture, the CPU one the image
+            TexData *tex = &o->tex;
+            float width = (float)(tex->image.data != NULL ? tex->image.width : tex->texture.width);
+            float height = (float)(tex->image.data != NULL ? tex->image.height : tex->texture.height);
+            return (Rectangle){ tex->position.x - 1.0f, tex->position.y - 1.0f, width + 2.0f, height + 2.0f };
+        } break;
+
+        default: {
+            PHANIM_UNREACHABLE("Unknown object kind!");
+        } break;
+    }
+    return (Rectangle){0};
+}
+
+static void obj_touch(size_t id)
+{
+    Touched *t = &CORE.touched;
+    if (t->all) return;
+    if (id >= t->capacity) {
+        // Only the culling grid knows how many objects there were, it catches up
+        t->all = true;
+        return;
+    }
+    if (t->flags[id]) return;
+    t->flags[id] = 1;
+    t->list[t->count++] = id;
+}
+
+static void obj_touch_all(void)
+{
+    CORE.touched.all = true;
+}
+
+// Whether drawing the object would change any pixel
+static bool object_visible(Object *o)
+{
+    if (!o->should_render) return false;
+    switch (o->kind) {
+        case OK_CIRCLE: {
+            CircleData *c = &o->circle;
+            return c->color.a > 0 || (c->stroke_width > 0.0f && c->stroke_color.a > 0);
+        } break;
+
+        case OK_LINE: {
+            return o->line.color.a > 0;
+        } break;
+
+        case OK_RECT: {
+            return o->rect.color.a > 0;
+        } break;
+
+        case OK_TEX: {
+            return true;
+        } break;
+
+        default: {
+            PHANIM_UNREACHABLE("Unknown object kind!");
+        } break;
+    }
+    return false;
+}
+
+// Transformation raylib applies to what's drawn right now
+static Matrix render_mvp(void)
+{
+    return MatrixMultiply(MatrixMultiply(rlGetMatrixTransform(), rlGetMatrixModelview()), rlGetMatrixProjection());
+}
+
+// The part of the scene that ends up on screen: the canvas with the CPU backend, with
+// raylib whatever the current camera and render target show
+static Rectangle render_view(void)
+{
+    if (CORE.backend == RB_CPU) {
+        return (Rectangle){ 0.0f, 0.0f, (float)CORE.canvas.width, (float)CORE.canvas.height };
+    }
+    Matrix inverse = MatrixInvert(render_mvp());
+    Vector2 lo = { INFINITY, INFINITY }, hi = { -INFINITY, -INFINITY };
+    static const Vector2 corners[] = { { -1.0f, -1.0f }, { 1.0f, -1.0f }, { 1.0f, 1.0f }, { -1.0f, 1.0f } };
+    for (size_t i = 0; i < 4; i++) {
+        Vector3 p = Vector3Transform((Vector3){ corners[i].x, corners[i].y, 0.0f }, inverse);
+        lo = Vector2Min(lo, (Vector2){ p.x, p.y });
+        hi = Vector2Max(hi, (Vector2){ p.x, p.y });
+    }
+    return (Rectangle){ lo.x, lo.y, hi.x - lo.x, hi.y - lo.y };
+}
+
+static size_t cull_bucket(int cx, int cy)
+{
+    return (((uint32_t)cx * 73856093u) ^ ((uint32_t)cy * 19349663u)) & (CULL_BUCKETS - 1);
+}
+
+static void cull_bucket_remove(CullBucket *bucket, size_t id)
+{
+    for (size_t i = 0; i < bucket->count; i++) {
+        if (bucket->items[i] == id) {
+            bucket->items[i] = bucket->items[--bucket->count];
+            return;
+        }
+    }
+}
+
+static void cull_bucket_push(CullBucket *bucket, size_t id)
+{
+    if (bucket->count >= bucket->capacity) {
+        bucket->capacity = bucket->capacity == 0 ? DEFAULT_INIT_CAP : bucket->capacity * 2;
+        bucket->items = MemRealloc(bucket->items, bucket->capacity * sizeof(*bucket->items));
+    }
+    bucket->items[bucket->count++] = id;
+}
+
+static void cull_remove(size_t id)
+{
+    CullGrid *g = &CORE.cull;
+    switch (g->slots[id]) {
+        case CULL_CELLS: {
+            PhanimClip c = g->cells[id];
+            for (int cy = c.y0; cy < c.y1; cy++) {
+                for (int cx = c.x0; cx < c.x1; cx++) {
+                    cull_bucket_remove(&g->buckets[cull_bucket(cx, cy)], id);
+                }
+            }
+        } break;
+
+        case CULL_BIG: {
+            cull_bucket_remove(&g->big, id);
+        } break;
+
+        default: break;
+    }
+    g->slots[id] = CULL_NONE;
+}
+
+static void cull_insert(size_t id)
+{
+    CullGrid *g = &CORE.cull;
+    Object *o = &CORE.objs[id];
+    if (!object_visible(o)) return;
+
+    Rectangle b = object_bounds(o);
+    g->bounds[id] = b;
+    // Tex objects that haven't been drawn yet don't know their size
+    bool unsized = o->kind == OK_TEX && o->tex.image.data == NULL && o->tex.texture.id == 0;
+    float x0 = floorf(b.x / CULL_CELL_SIZE), y0 = floorf(b.y / CULL_CELL_SIZE);
+    float x1 = floorf((b.x + b.width) / CULL_CELL_SIZE) + 1.0f, y1 = floorf((b.y + b.height) / CULL_CELL_SIZE) + 1.0f;
+    // Also catches NaNs and bounds too far out for an int
+    if (unsized || !((x1 - x0) * (y1 - y0) <= CULL_MAX_CELLS)) {
+        g->slots[id] = CULL_BIG;
+        cull_bucket_push(&g->big, id);
+        return;
+    }
+
+    PhanimClip c = { (int)x0, (int)y0, (int)x1, (int)y1 };
+    g->cells[id] = c;
+    g->slots[id] = CULL_CELLS;
+    for (int cy = c.y0; cy < c.y1; cy++) {
+        for (int cx = c.x0; cx < c.x1; cx++) {
+            cull_bucket_push(&g->buckets[cull_bucket(cx, cy)], id);
+        }
+    }
+}
+
+// Moves the touched objects to where they are now and returns the first one that could
+// be seen before or after, SIZE_MAX if there is none. After seeking or loading a scene,
+// the grid is built from scratch and every object counts as changed.
+static size_t cull_update(void)
+{
+    CullGrid *g = &CORE.cull;
+    Touched *t = &CORE.touched;
+    if (t->all || g->capacity < CORE.obj_count) {
+        if (g->capacity < CORE.obj_count) {
+            size_t cap = CORE.obj_capacity > CORE.obj_count ? CORE.obj_capacity : CORE.obj_count;
+            g->slots = MemRealloc(g->slots, cap * sizeof(*g->slots));
+            g->bounds = MemRealloc(g->bounds, cap * sizeof(*g->bounds));
+            g->cells = MemRealloc(g->cells, cap * sizeof(*g->cells));
+            g->seen = MemRealloc(g->seen, cap * sizeof(*g->seen));
+            g->visible = MemRealloc(g->visible, cap * sizeof(*g->visible));
+            t->flags = MemRealloc(t->flags, cap * sizeof(*t->flags));
+            t->list = MemRealloc(t->list, cap * sizeof(*t->list));
+            memset(g->seen, 0, cap * sizeof(*g->seen));
+            g->query = 0;
+            g->capacity = t->capacity = cap;
+        }
+        if (g->buckets == NULL) g->buckets = MemAlloc(CULL_BUCKETS * sizeof(*g->buckets));
+        for (size_t i = 0; i < CULL_BUCKETS; i++) {
+            g->buckets[i].count = 0;
+        }
+        g->big.count = 0;
+        memset(g->slots, CULL_NONE, g->capacity * sizeof(*g->slots));
+        for (size_t i = 0; i < CORE.obj_count; i++) {
+            cull_insert(i);
+        }
+        memset(t->flags, 0, t->capacity * sizeof(*t->flags));
+        t->count = 0;
+        t->all = false;
+        return 0;
+    }
+
+    size_t first = SIZE_MAX;
+    for (size_t i = 0; i < t->count; i++) {
+        size_t id = t->list[i];
+        t->flags[id] = 0;
+        bool listed = g->slots[id] != CULL_NONE;
+        cull_remove(id);
+        cull_insert(id);
+        if ((listed || g->slots[id] != CULL_NONE) && id < first) first = id;
+    }
+    t->count = 0;
+    return first;
+}
+
+// Big objects skip the test: their bounds may be unknown (unsized tex) or not even
+// finite, and CheckCollisionRecs() is false for anything with a NaN in it
+static bool cull_overlaps(size_t id, Rectangle view)
+{
+    CullGrid *g = &CORE.cull;
+    return g->slots[id] == CULL_BIG || CheckCollisionRecs(g->bounds[id], view);
+}
+
+static int compare_ids(const void *a, const void *b)
+{
+    size_t x = *(const size_t *)a, y = *(const size_t *)b;
+    return (x > y) - (x < y);
+}
+
+// Finds the objects overlapping `view` that can be seen, in object order, and returns
+// how many there are in `CORE.cull.visible`
+static size_t cull_query(Rectangle view)
+{
+    CullGrid *g = &CORE.cull;
+    if (++g->query == 0) {
+        memset(g->seen, 0, g->capacity * sizeof(*g->seen));
+        g->query = 1;
+    }
+
+    size_t count = 0;
+    float x0 = floorf(view.x / CULL_CELL_SIZE), y0 = floorf(view.y / CULL_CELL_SIZE);
+    float x1 = floorf((view.x + view.width) / CULL_CELL_SIZE) + 1.0f, y1 = floorf((view.y + view.height) / CULL_CELL_SIZE) + 1.0f;
+    if (!((x1 - x0) * (y1 - y0) <= CULL_BUCKETS)) {
+        // Zoomed out so far that the grid wouldn't help
+        for (size_t i = 0; i < CORE.obj_count; i++) {
+            if (g->slots[i] != CULL_NONE && cull_overlaps(i, view)) g->visible[count++] = i;
+        }
+        g->visible_count = count;
+        return count;
+    }
+
+    for (int cy = (int)y0; cy < (int)y1; cy++) {
+        for (int cx = (int)x0; cx < (int)x1; cx++) {
+            CullBucket *bucket = &g->buckets[cull_bucket(cx, cy)];
+            for (size_t i = 0; i < bucket->count; i++) {
+                size_t id = bucket->items[i];
+                if (g->seen[id] == g->query) continue;
+                g->seen[id] = g->query;
+                if (cull_overlaps(id, view)) g->visible[count++] = id;
+            }
+        }
+    }
+    for (size_t i = 0; i < g->big.count; i++) {
+        size_t id = g->big.items[i];
+        g->seen[id] = g->query;
+        g->visible[count++] = id;
+    }
+
+    // Sorting a large part of the scene takes longer than walking all of it
+    if (count > CORE.obj_count / 16) {
+        count = 0;
+        for (size_t i = 0; i < CORE.obj_count; i++) {
+            if (g->seen[i] == g->query && cull_overlaps(i, view)) g->visible[count++] = i;
+        }
+    } else {
+        qsort(g->visible, count, sizeof(*g->visible), compare_ids);
+    }
+    g->visible_count = count;
+    return count;
+}
+
+static void cull_free(void)
+{
+    CullGrid *g = &CORE.cull;
+    if (g->buckets != NULL) {
+        for (size_t i = 0; i < CULL_BUCKETS; i++) {
+            MemFree(g->buckets[i].items);
+        }
+    }
+    MemFree(g->buckets);
+    MemFree(g->big.items);
+    MemFree(g->slots);
+    MemFree(g->bounds);
+    MemFree(g->cells);
+    MemFree(g->seen);
+    MemFree(g->visible);
+    *g = (CullGrid) {0};
+    MemFree(CORE.touched.flags);
+    MemFree(CORE.touched.list);
+    CORE.touched = (Touched) { .all = true };
+}
+
+// Decides how this frame uses the static layer, given the first object that changed
+// since the last one and what the frame is drawn into. The layer shrinks right away
+// when one of its objects changes and only grows once objects settle, so an object
+// that keeps changing doesn't get the layer redrawn on every frame.
+static LayerPass static_layer_plan(size_t first_changed, int width, int height, unsigned target, Matrix mvp)
+{
+    StaticLayer *l = &CORE.layer;
+    l->pass = LAYER_OFF;
+    if (!CORE.layer_enabled || l->failed) return LAYER_OFF;
+
+    Color bg = CORE.background;
+    if (l->width != width || l->height != height || l->target != target || memcmp(&l->mvp, &mvp, sizeof(mvp)) != 0
+        || l->background.r != bg.r || l->background.g != bg.g || l->background.b != bg.b || l->background.a != bg.a) {
+        l->valid = false;
+        l->width = width;
+        l->height = height;
+        l->target = target;
+        l->mvp = mvp;
+        l->background = bg;
+    }
+
+    if (first_changed > CORE.obj_count) first_changed = CORE.obj_count;
+    LayerPass pass = LAYER_REUSE;
+    if (!l->valid || first_changed < l->split) {
+        l->split = first_changed;
+        l->settle = 0;
+        l->valid = true;
+        pass = LAYER_BUILD;
+    } else if (first_changed > l->split) {
+        l->pending = l->settle == 0 || first_changed < l->pending ? first_changed : l->pending;
+        if (++l->settle >= STATIC_LAYER_SETTLE) {
+            l->split = l->pending;
+            l->settle = 0;
+            pass = LAYER_BUILD;
+        }
+    } else {
+        l->settle = 0;
+    }
+
+    // Nothing worth caching, the frame is drawn like without a layer
+    if (l->split == 0) return LAYER_OFF;
+    l->pass = pass;
+    return pass;
+}
+
+static void static_layer_copy_tile(Color *dst, const Color *src, PhanimClip clip)
+{
+    size_t stride = (size_t)CORE.canvas.width;
+    for (int y = clip.y0; y < clip.y1; y++) {
+        size_t offset = (size_t)y * stride + (size_t)clip.x0;
+        memcpy(&dst[offset], &src[offset], (size_t)(clip.x1 - clip.x0) * sizeof(Color));
+    }
+}
+
+// Covers the target with a single triangle and copies the layer's pixels one to one
+static const char *STATIC_LAYER_VS =
+    "#version 330\n"
+    "void main()\n"
+    "{\n"
+    "    vec2 pos = vec2(float((gl_VertexID & 1) << 2), float((gl_VertexID & 2) << 1)) - 1.0;\n"
+    "    gl_Position = vec4(pos, 0.0, 1.0);\n"
+    "}\n";
+
+static const char *STATIC_LAYER_FS =
+    "#version 330\n"
+    "uniform sampler2D layer;\n"
+    "out vec4 finalColor;\n"
+    "void main()\n"
+    "{\n"
+    "    finalColor = texelFetch(layer, ivec2(gl_FragCoord.xy), 0);\n"
+    "}\n";
+
+// Makes sure the layer's framebuffer is `width` x `height`
+static bool static_layer_load_gl(int width, int height)
+{
+    StaticLayer *l = &CORE.layer;
+    if (l->fbo != 0 && l->texture_width == width && l->texture_height == height) return true;
+
+    if (l->shader == 0) {
+        l->shader = rlLoadShaderCode(STATIC_LAYER_VS, STATIC_LAYER_FS);
+        if (l->shader == 0 || l->shader == rlGetShaderIdDefault()) {
+            TraceLog(LOG_WARNING, "PHANIM: Failed to load the static layer shader, redrawing every object");
+            l->shader = 0;
+            l->failed = true;
+            return false;
+        }
+        l->layer_loc = rlGetLocationUniform(l->shader, "layer");
+        // The vertex shader has no inputs, but a vertex array still has to be bound
+        l->vao = rlLoadVertexArray();
+    }
+
+    // Loading and attaching framebuffers leaves none bound
+    unsigned target = rlGetActiveFramebuffer();
+    if (l->fbo != 0) {
+        rlUnloadFramebuffer(l->fbo);
+        rlUnloadTexture(l->texture);
+    }
+    l->texture = rlLoadTexture(NULL, width, height, RL_PIXELFORMAT_UNCOMPRESSED_R8G8B8A8, 1);
+    l->fbo = rlLoadFramebuffer();
+    rlFramebufferAttach(l->fbo, l->texture, RL_ATTACHMENT_COLOR_CHANNEL0, RL_ATTACHMENT_TEXTURE2D, 0);
+    bool complete = rlFramebufferComplete(l->fbo);
+    rlEnableFramebuffer(target);
+    if (!complete) {
+        TraceLog(LOG_WARNING, "PHANIM: Failed to create the static layer framebuffer, redrawing every object");
+        static_layer_unload();
+        CORE.layer.failed = true;
+        return false;
+    }
+    l->texture_width = width;
+    l->texture_height = height;
+    return true;
+}
+
+// Saves what was drawn so far, resolving multisampled targets on the way
+static void static_layer_capture_gl(void)
+{
+    StaticLayer *l = &CORE.layer;
+    profile_run_switch(&CORE.profile.run, PP_RENDER_BIN);
+    rlDrawRenderBatchActive();
+    rlBindFramebuffer(RL_READ_FRAMEBUFFER, l->target);
+    rlBindFramebuffer(RL_DRAW_FRAMEBUFFER, l->fbo);
+    rlBlitFramebuffer(0, 0, l->width, l->height, 0, 0, l->width, l->height, STATIC_LAYER_BLIT_MASK);
+    rlEnableFramebuffer(l->target);
+}
+
+// Overwrites the target with the layer. Blitting into a multisampled framebuffer isn't
+// allowed, so this draws it instead.
+static void static_layer_restore_gl(void)
+{
+    StaticLayer *l = &CORE.layer;
+    rlDrawRenderBatchActive();
+    rlDisableColorBlend();
+    rlEnableShader(l->shader);
+    int slot = 0;
+    rlSetUniform(l->layer_loc, &slot, RL_SHADER_UNIFORM_INT, 1);
+    rlActiveTextureSlot(0);
+    rlEnableTexture(l->texture);
+    rlEnableVertexArray(l->vao);
+    rlDrawVertexArray(0, 3);
+    rlDisableVertexArray();
+    rlDisableTexture();
+    rlDisableShader();
+    rlEnableColorBlend();
+}
+
+static void static_layer_unload(void)
+{
+    StaticLayer *l = &CORE.layer;
+    if (l->fbo != 0) {
+        unsigned target = rlGetActiveFramebuffer();
+        rlUnloadFramebuffer(l->fbo);
+        rlUnloadTexture(l->texture);
+        rlEnableFramebuffer(target);
+    }
+    if (l->shader != 0) {
+        rlUnloadShaderProgram(l->shader);
+        rlUnloadVertexArray(l->vao);
+    }
+    MemFree(l->pixels);
+    *l = (StaticLayer) {0};
+}
+
+static void draw_object_cpu(PhanimClip clip, Object *o)
+{
+    PhanimCanvas *canvas = &CORE.canvas;
+    switch (o->kind) {
+        case OK_CIRCLE: {
+            CircleData *c = &o->circle;
+            PhanimRasterCircle(canvas, clip, c->center, c->radius, c->color);
+            PhanimRasterRing(canvas, clip, c->center, c->radius, c->stroke_width, c->stroke_color);
+        } break;
+
+        case OK_LINE: {
+            LineData *l = &o->line;
+            PhanimRasterLine(canvas, clip, l->pos, Vector2Add(l->pos, l->size), l->thickness, l->color);
+        } break;
+
+        case OK_RECT: {
+            RectData *r = &o->rect;
+            Vector2 top_left = Vector2Subtract(r->pos, Vector2Scale(r->size, 0.5));
+            PhanimRasterRect(canvas, clip, top_left, r->size, r->color);
+        } break;
+
+        case OK_TEX: {
+            TexData *tex = &o->tex;
+            PhanimRasterImage(canvas, clip, tex->image.data, tex->image.width, tex->image.height, tex->position);
+        } break;
+
+        default: {
+            PHANIM_UNREACHABLE("Unknown object kind!");
+        } break;
+    }
+}
+
+static void raster_tiles(void)
+{
+    size_t tile_count = CORE.tile_cols * CORE.tile_rows;
+    for (;;) {
+        size_t t = atomic_fetch_add(&CORE.pool.next_tile, 1);
+        if (t >= tile_count) break;
+
+        int tx = (int)(t % CORE.tile_cols), ty = (int)(t / CORE.tile_cols);
+        PhanimClip clip = {
+            .x0 = tx * RASTER_TILE_SIZE,
+            .y0 = ty * RASTER_TILE_SIZE,
+            .x1 = (int)fminf((float)((tx + 1) * RASTER_TILE_SIZE), (float)CORE.canvas.width),
+            .y1 = (int)fminf((float)((ty + 1) * RASTER_TILE_SIZE), (float)CORE.canvas.height),
+        };
+
+        StaticLayer *layer = &CORE.layer;
+        if (layer->pass == LAYER_REUSE) {
+            static_layer_copy_tile(CORE.canvas.pixels, layer->pixels, clip);
+        } else {
+            // Unlike the raylib backend, the caller has no way to clear the framebuffer
+            PhanimRasterClear(&CORE.canvas, clip, CORE.background);
+        }
+
+        // When building the layer, the tile is saved once its objects before the split
+        // are drawn
+        size_t start = CORE.tile_starts[t], end = CORE.tile_starts[t + 1];
+        size_t split = start;
+        if (layer->pass == LAYER_BUILD) {
+            while (split < end && CORE.tile_objs[split] < layer->split) split++;
+        }
+        ProfileRun run = { .phase = -1 };
+        for (size_t i = start; i < end; i++) {
+            if (i == split && layer->pass == LAYER_BUILD) static_layer_copy_tile(layer->pixels, CORE.canvas.pixels, clip);
+            Object *o = &CORE.objs[CORE.tile_objs[i]];
+            profile_run_switch(&run, PP_RENDER_LINE + o->kind);
+            draw_object_cpu(clip, o);
+        }
+        if (split == end && layer->pass == LAYER_BUILD) static_layer_copy_tile(layer->pixels, CORE.canvas.pixels, clip);
+        profile_run_switch(&run, -1);
+    }
+}
+
+static void *raster_worker(void *arg)
+{
+    RasterPool *pool = arg;
+    size_t seen = 0;
+    for (;;) {
+        pthread_mutex_lock(&pool->lock);
+        while (pool->generation == seen && !pool->quit) {
+            pthread_cond_wait(&pool->wake, &pool->lock);
+        }
+        if (pool->quit) {
+            pthread_mutex_unlock(&pool->lock);
+            break;
+        }
+        seen = pool->generation;
+        pthread_mutex_unlock(&pool->lock);
+
+        raster_tiles();
+
+        pthread_mutex_lock(&pool->lock);
+        pool->busy--;
+        if (pool->busy == 0) pthread_cond_signal(&pool->idle);
+        pthread_mutex_unlock(&pool->lock);
+    }
+    return NULL;
+}
+
+static void raster_pool_start(void)
+{
+    // Started lazily on the first frame, so a process can still be forked safely
+    // after the scene is built
+    RasterPool *pool = &CORE.pool;
+    size_t count = CORE.render_threads;
+    if (count == 0) {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        count = cores > 0 ? (size_t)cores : 1;
+    }
+
+    // The rendering thread takes part too, so it only needs `count - 1` workers
+    pool->thread_count = count - 1;
+    pool->generation = 0;
+    pool->busy = 0;
+    pool->quit = false;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    pthread_cond_init(&pool->idle, NULL);
+    pool->threads = MemAlloc((pool->thread_count + 1) * sizeof(*pool->threads));
+    for (size_t i = 0; i < pool->thread_count; i++) {
+        pthread_create(&pool->threads[i], NULL, raster_worker, pool);
+    }
+}
+
+static void raster_pool_stop(void)
+{
+    RasterPool *pool = &CORE.pool;
+    if (pool->threads == NULL) return;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->quit = true;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+    for (size_t i = 0; i < pool->thread_count; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->wake);
+    pthread_cond_destroy(&pool->idle);
+    MemFree(pool->threads);
+    *pool = (RasterPool) {0};
+}
+
+static void render_cpu(void)
+{
+    if (CORE.pool.threads == NULL) raster_pool_start();
+
+    Arena_Mark mark = arena_snapshot(&CORE.temp_arena);
+    CORE.tile_cols = (CORE.canvas.width + RASTER_TILE_SIZE - 1) / RASTER_TILE_SIZE;
+    CORE.tile_rows = (CORE.canvas.height + RASTER_TILE_SIZE - 1) / RASTER_TILE_SIZE;
+    size_t tile_count = CORE.tile_cols * CORE.tile_rows;
+
+    // Bin every visible object into the tiles its bounding box overlaps. Two passes (count,
+    // then fill) keep the bins in one flat array, in object order.
+    profile_run_switch(&CORE.profile.run, PP_RENDER_BIN);
+    size_t first_changed = cull_update();
+    size_t visible = cull_query(render_view());
+    LayerPass pass = static_layer_plan(first_changed, CORE.canvas.width, CORE.canvas.height, 0, MatrixIdentity());
+    if (pass != LAYER_OFF && CORE.layer.pixels == NULL) {
+        CORE.layer.pixels = MemAlloc((size_t)CORE.canvas.width * CORE.canvas.height * sizeof(Color));
+    }
+    size_t *tile_counts = arena_alloc(&CORE.temp_arena, (tile_count + 1) * sizeof(size_t));
+    memset(tile_counts, 0, (tile_count + 1) * sizeof(size_t));
+    PhanimClip *tile_ranges = arena_alloc(&CORE.temp_arena, (visible + 1) * sizeof(PhanimClip));
+    for (size_t k = 0; k < visible; k++) {
+        size_t i = CORE.cull.visible[k];
+        Object *o = &CORE.objs[i];
+        tile_ranges[k] = (PhanimClip) {0};
+        // Already part of the layer
+        if (pass == LAYER_REUSE && i < CORE.layer.split) continue;
+        if (o->kind == OK_TEX && o->tex.image.data == NULL) {
+            o->tex.image = tex_cache_get(&o->tex)->image;
+            obj_touch(i);
+        }
+
+        Rectangle b = object_bounds(o);
+        float max_x = (float)(CORE.tile_cols * RASTER_TILE_SIZE) - 1.0f;
+        float max_y = (float)(CORE.tile_rows * RASTER_TILE_SIZE) - 1.0f;
+        if (b.x >= max_x || b.y >= max_y || b.x + b.width < 0.0f || b.y + b.height < 0.0f) continue;
+        PhanimClip r = {
+            .x0 = (int)fmaxf(b.x, 0.0f) / RASTER_TILE_SIZE,
+            .y0 = (int)fmaxf(b.y, 0.0f) / RASTER_TILE_SIZE,
+            .x1 = (int)fminf(b.x + b.width, max_x) / RASTER_TILE_SIZE + 1,
+            .y1 = (int)fminf(b.y + b.height, max_y) / RASTER_TILE_SIZE + 1,
+        };
+        tile_ranges[k] = r;
+        for (int ty = r.y0; ty < r.y1; ty++) {
+            for (int tx = r.x0; tx < r.x1; tx++) {
+                tile_counts[ty * CORE.tile_cols + tx]++;
+            }
+        }
+    }
+
+    CORE.tile_starts = arena_alloc(&CORE.temp_arena, (tile_count + 1) * sizeof(size_t));
+    CORE.tile_starts[0] = 0;
+    for (size_t t = 0; t < tile_count; t++) {
+        CORE.tile_starts[t + 1] = CORE.tile_starts[t] + tile_counts[t];
+        tile_counts[t] = CORE.tile_starts[t];
+    }
+    CORE.tile_objs = arena_alloc(&CORE.temp_arena, (CORE.tile_starts[tile_count] + 1) * sizeof(size_t));
+    for (size_t k = 0; k < visible; k++) {
+        PhanimClip r = tile_ranges[k];
+        for (int ty = r.y0; ty < r.y1; ty++) {
+            for (int tx = r.x0; tx < r.x1; tx++) {
+                CORE.tile_objs[tile_counts[ty * CORE.tile_cols + tx]++] = CORE.cull.visible[k];
+            }
+        }
+    }
+
+    profile_run_switch(&CORE.profile.run, -1);
+
+    RasterPool *pool = &CORE.pool;
+    pthread_mutex_lock(&pool->lock);
+    atomic_store(&pool->next_tile, 0);
+    pool->busy = pool->thread_count;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+
+    raster_tiles();
+
+    pthread_mutex_lock(&pool->lock);
+    while (pool->busy > 0) {
+        pthread_cond_wait(&pool->idle, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    CORE.tile_starts = NULL;
+    CORE.tile_objs = NULL;
+    arena_rewind(&CORE.temp_arena, mark);
+}
+
+static size_t float_track_add(ObjField dst, float start, float target)
+{
+    anim_track_add(&CORE.float_track, &CORE.float_lanes, dst, start, target);
+    return CORE.float_track.count - 1;
+}
+
+static size_t vec2_track_add(ObjField dst, Vector2 start, Vector2 target)
+{
+    anim_track_add(&CORE.vec2_track, &CORE.vec2_lanes, dst, start, target);
+    return CORE.vec2_track.count - 1;
+}
+
+static size_t color_track_add(ObjField dst, Color start, Color target)
+{
+    anim_track_add(&CORE.color_track, &CORE.color_lanes, dst, start, target);
+    return CORE.color_track.count - 1;
+}
+
+static void anim_start(Anim *a)
+{
+    if (a->obj_id != PHANIM_NO_ANIM && !CORE.objs[a->obj_id].should_render) {
+        CORE.objs[a->obj_id].should_render = true;
+        obj_touch(a->obj_id);
+    }
+    if (a->slot == PHANIM_NO_SLOT) {
+        CORE.active[CORE.active_count++] = a->id;
+        return;
+    }
+
+    switch (a->val_type) {
+        case AVT_FLOAT: {
+            anim_lanes_push(&CORE.float_lanes, &CORE.float_track, a);
+        } break;
+
+        case AVT_VEC2: {
+            anim_lanes_push(&CORE.vec2_lanes, &CORE.vec2_track, a);
+        } break;
+
+        case AVT_COLOR: {
+            anim_lanes_push(&CORE.color_lanes, &CORE.color_track, a);
+        } break;
+
+        default: {
+            PHANIM_UNREACHABLE("Unknown anim value type!");
+        } break;
+    }
+}
+
+// The new values of all lanes are computed at once by the batched kernels, then
+// written back while the finished lanes get compacted away in place, which keeps
+// them in id order. When two anims drive the same property at once, the later one
+// wins, just like when seeking.
+#define anim_lanes_finish(lanes, time)                                  \
+    do {                                                                \
+        size_t kept = 0;                                                \
+        for (size_t i = 0; i < (lanes)->count; i++) {                   \
+            char *dst = (char *)CORE.objs + (lanes)->dst[i];            \
+            if (memcmp(dst, &(lanes)->value[i], sizeof((lanes)->value[i])) != 0) { \
+                memcpy(dst, &(lanes)->value[i], sizeof((lanes)->value[i])); \
+                obj_touch((lanes)->dst[i] / sizeof(Object));            \
+            }                                                           \
+            if ((time) - (lanes)->begin[i] < (lanes)->duration[i]) {    \
+                if (kept != i) anim_lanes_move(lanes, kept, i);         \
+                kept++;                                                 \
+            }                                                           \
+        }                                                               \
+        (lanes)->count = kept;                                          \
+    } while (0)
+
+static void update_float_lanes(FloatLanes *l, float time)
+{
+    PhanimKernelRates(l->func, l->begin, l->duration, time, l->t, l->count);
+    PhanimKernelLerpFloat(l->start, l->target, l->t, l->value, l->count);
+    anim_lanes_finish(l, time);
+}
+
+static void update_vec2_lanes(Vec2Lanes *l, float time)
+{
+    PhanimKernelRates(l->func, l->begin, l->duration, time, l->t, l->count);
+    PhanimKernelLerpVec2(l->start, l->target, l->t, l->value, l->count);
+    anim_lanes_finish(l, time);
+}
+
+static void update_color_lanes(ColorLanes *l, float time)
+{
+    PhanimKernelRates(l->func, l->begin, l->duration, time, l->t, l->count);
+    PhanimKernelLerpColor(l->start, l->target, l->t, l->value, l->count);
+    anim_lanes_finish(l, time);
+}
+
+static int compare_fields(const void *a, const void *b)
+{
+    ObjField x = *(const ObjField *)a, y = *(const ObjField *)b;
+    return (x > y) - (x < y);
+}
+
+static size_t bake_unique_fields(ObjField *fields, const ObjField *src, size_t count)
+{
+    if (count == 0) return 0;
+    memcpy(fields, src, count * sizeof(*fields));
+    qsort(fields, count, sizeof(*fields), compare_fields);
+    size_t unique = 1;
+    for (size_t i = 1; i < count; i++) {
+        if (fields[i] != fields[unique - 1]) fields[unique++] = fields[i];
+    }
+    return unique;
+}
+
+static void bake_record(size_t frame)
+{
+    Bake *b = &CORE.bake;
+    u8 *dst = b->frames + frame * b->frame_size;
+    uint32_t current = (uint32_t)CORE.anim_current;
+    memcpy(dst, &current, sizeof(current));
+    dst += sizeof(current);
+
+    size_t counts[] = { b->float_count, b->vec2_count, b->color_count };
+    size_t sizes[] = { sizeof(float), sizeof(Vector2), sizeof(Color) };
+    ObjField *field = b->fields;
+    for (size_t k = 0; k < 3; k++) {
+        for (size_t i = 0; i < counts[k]; i++) {
+            memcpy(dst, (char *)CORE.objs + *field++, sizes[k]);
+            dst += sizes[k];
+        }
+    }
+
+    for (size_t i = 0; i < CORE.obj_count; i++) {
+        if (CORE.objs[i].should_render && b->render_from[i] == SIZE_MAX) b->render_from[i] = frame;
+    }
+}
+
+// Shows the frame nearest to `time`
+static void bake_apply(float time)
+{
+    Bake *b = &CORE.bake;
+    size_t frame = (size_t)(time * b->fps + 0.5f);
+    if (frame >= b->frame_count) frame = b->frame_count - 1;
+
+    const u8 *src = b->frames + frame * b->frame_size;
+    uint32_t current;
+    memcpy(&current, src, sizeof(current));
+    src += sizeof(current);
+
+    size_t counts[] = { b->float_count, b->vec2_count, b->color_count };
+    size_t sizes[] = { sizeof(float), sizeof(Vector2), sizeof(Color) };
+    ObjField *field = b->fields;
+    for (size_t k = 0; k < 3; k++) {
+        for (size_t i = 0; i < counts[k]; i++, field++) {
+            char *dst = (char *)CORE.objs + *field;
+            if (memcmp(dst, src, sizes[k]) != 0) {
+                memcpy(dst, src, sizes[k]);
+                obj_touch(*field / sizeof(Object));
+            }
+            src += sizes[k];
+        }
+    }
+
+    for (size_t i = 0; i < CORE.obj_count; i++) {
+        bool render = b->render_from[i] <= frame;
+        if (CORE.objs[i].should_render != render) {
+            CORE.objs[i].should_render = render;
+            obj_touch(i);
+        }
+    }
+    CORE.anim_current = current;
+    CORE.completed = frame == b->frame_count - 1;
+}
+
+// Baked frames are only valid for the scene they were sampled from. The live state
+// is rebuilt at the current time, so playback carries on from where it is.
+static void bake_drop(void)
+{
+    if (CORE.bake.frames == NULL) return;
+    bool ready = CORE.bake.ready;
+    MemFree(CORE.bake.frames);
+    MemFree(CORE.bake.fields);
+    MemFree(CORE.bake.render_from);
+    CORE.bake = (Bake) {0};
+    if (ready) PhanimSeek(CORE.time);
+}
+
+static uint64_t scene_align(uint64_t offset)
+{
+    return (offset + 15) & ~(uint64_t)15;
+}
+
+// Pads the file up to the next aligned offset and writes `size` bytes there
+static bool scene_write(FILE *f, uint64_t *offset, const void *data, size_t size)
+{
+    static const char zeros[16] = {0};
+    uint64_t aligned = scene_align(*offset);
+    if (fwrite(zeros, 1, aligned - *offset, f) != aligned - *offset) return false;
+    if (size > 0 && fwrite(data, 1, size, f) != size) return false;
+    *offset = aligned + size;
+    return true;
+}
+
+static bool scene_table_ok(uint64_t offset, uint64_t count, size_t size, uint64_t file_size)
+{
+    return offset % 16 == 0 && offset <= file_size && count <= (file_size - offset) / size;
+}
+
+// Everything the runtime indexes with is checked up front, so a corrupt file can't
+// make it read or write outside of the mapping
+static bool scene_validate(const SceneHeader *h, size_t file_size)
+{
+    if (memcmp(h->magic, PHANIM_SCENE_MAGIC, sizeof(PHANIM_SCENE_MAGIC)) != 0) return false;
+    if (h->version != PHANIM_SCENE_VERSION || h->byte_order != PHANIM_SCENE_BYTE_ORDER) return false;
+    if (h->object_size != sizeof(Object) || h->anim_size != sizeof(Anim)) return false;
+    if (h->file_size != file_size) return false;
+
+    bool ok = scene_table_ok(h->objs, h->obj_count, sizeof(Object), file_size)
+        && scene_table_ok(h->texes, h->tex_count, sizeof(uint64_t), file_size)
+        && scene_table_ok(h->anims, h->anim_count, sizeof(Anim), file_size)
+        && scene_table_ok(h->anim_starts, h->anim_count, sizeof(float), file_size)
+        && scene_table_ok(h->float_start, h->float_count, sizeof(float), file_size)
+        && scene_table_ok(h->float_target, h->float_count, sizeof(float), file_size)
+        && scene_table_ok(h->float_dst, h->float_count, sizeof(ObjField), file_size)
+        && scene_table_ok(h->vec2_start, h->vec2_count, sizeof(Vector2), file_size)
+        && scene_table_ok(h->vec2_target, h->vec2_count, sizeof(Vector2), file_size)
+        && scene_table_ok(h->vec2_dst, h->vec2_count, sizeof(ObjField), file_size)
+        && scene_table_ok(h->color_start, h->color_count, sizeof(Color), file_size)
+        && scene_table_ok(h->color_target, h->color_count, sizeof(Color), file_size)
+        && scene_table_ok(h->color_dst, h->color_count, sizeof(ObjField), file_size)
+        && scene_table_ok(h->strings, h->strings_size, 1, file_size);
+    if (!ok) return false;
+
+    const char *base = (const char *)h;
+    const uint64_t *texes = (const uint64_t *)(base + h->texes);
+    const Object *objs = (const Object *)(base + h->objs);
+    size_t tex_objs = 0;
+    for (size_t i = 0; i < h->obj_count; i++) {
+        if (objs[i].kind < OK_LINE || objs[i].kind > OK_TEX) return false;
+        if (objs[i].kind == OK_TEX) tex_objs++;
+    }
+    // Loading turns the string offset of every tex object into a pointer, so each of
+    // them has to be listed exactly once
+    if (h->tex_count != tex_objs) return false;
+    Arena_Mark mark = arena_snapshot(&CORE.temp_arena);
+    u8 *listed = arena_alloc(&CORE.temp_arena, h->obj_count + 1);
+    memset(listed, 0, h->obj_count + 1);
+    for (size_t i = 0; i < h->tex_count && ok; i++) {
+        ok = texes[i] < h->obj_count && objs[texes[i]].kind == OK_TEX && !listed[texes[i]];
+        if (!ok) break;
+        listed[texes[i]] = 1;
+        const PhanimStr *text = &objs[texes[i]].tex.text;
+        uint64_t start = (uintptr_t)text->text;
+        ok = start < h->strings_size && text->count < h->strings_size - start
+            && base[h->strings + start + text->count] == '\0';
+    }
+    arena_rewind(&CORE.temp_arena, mark);
+    if (!ok) return false;
+
+    uint64_t counts[] = { h->float_count, h->vec2_count, h->color_count };
+    uint64_t dsts[] = { h->float_dst, h->vec2_dst, h->color_dst };
+    size_t sizes[] = { sizeof(float), sizeof(Vector2), sizeof(Color) };
+    for (size_t k = 0; k < 3; k++) {
+        const ObjField *dst = (const ObjField *)(base + dsts[k]);
+        for (size_t i = 0; i < counts[k]; i++) {
+            if (dst[i] / sizeof(Object) >= h->obj_count || dst[i] % sizeof(Object) + sizes[k] > sizeof(Object)) return false;
+        }
+    }
+
+    // PhanimAnimAtTime() binary searches the start times
+    const float *starts = (const float *)(base + h->anim_starts);
+    for (size_t i = 0; i < h->anim_count; i++) {
+        if (!isfinite(starts[i]) || (i > 0 && starts[i] < starts[i - 1])) return false;
+    }
+
+    const Anim *anims = (const Anim *)(base + h->anims);
+    for (size_t i = 0; i < h->anim_count; i++) {
+        const Anim *a = &anims[i];
+        // Anims are looked up by their id, so it has to be their index
+        if (a->id != i) return false;
+        if (a->kind < AK_CREATE || a->kind > AK_IMMEDIATE) return false;
+        if (a->group != PHANIM_NO_GROUP && a->group >= h->group_count) return false;
+        if (a->obj_id != PHANIM_NO_ANIM && a->obj_id >= h->obj_count) return false;
+        if (a->slot == PHANIM_NO_SLOT) continue;
+        if (a->val_type < AVT_FLOAT || a->val_type > AVT_COLOR) return false;
+        if (a->slot >= counts[a->val_type - AVT_FLOAT]) return false;
+        // PhanimEase() doesn't implement RF_3B1B_SMOOTH_STEP yet
+        if (a->func < RF_LINEAR || a->func > RF_QUINTIC_SMOOTH_STEP) return false;
+    }
+    return true;
+}
+
+static bool scene_error(SceneParser *p, PhanimToken tok, const char *fmt, ...)
+{
+    // The lexer's own errors take precedence, they are why the token is unexpected
+    char message[256];
+    if (tok.kind == PHANIM_TOKEN_ERROR) {
+        snprintf(message, sizeof(message), "%.*s", (int)tok.len, tok.text);
+    } else {
+        va_list args;
+        va_start(args, fmt);
+        vsnprintf(message, sizeof(message), fmt, args);
+        va_end(args);
+    }
+    TraceLog(LOG_WARNING, "%s:%zu:%zu: %s", p->path, tok.line, tok.col, message);
+    return false;
+}
+
+static void scene_next(SceneParser *p)
+{
+    p->tok = PhanimLexerNext(&p->lexer);
+}
+
+static bool scene_token_is(PhanimToken tok, const char *text)
+{
+    return strlen(text) == tok.len && memcmp(tok.text, text, tok.len) == 0;
+}
+
+static inline bool scene_is_punct(PhanimToken tok, char punct)
+{
+    return tok.kind == PHANIM_TOKEN_PUNCT && tok.text[0] == punct;
+}
+
+static bool scene_expect(SceneParser *p, char punct)
+{
+    if (!scene_is_punct(p->tok, punct)) return scene_error(p, p->tok, "Expected '%c'", punct);
+    scene_next(p);
+    return true;
+}
+
+static bool scene_parse_value(SceneParser *p, SceneValue *value)
+{
+    *value = (SceneValue) { .tok = p->tok };
+    if (p->tok.kind == PHANIM_TOKEN_STRING) {
+        scene_next(p);
+        return true;
+    }
+    if (p->tok.kind == PHANIM_TOKEN_NUMBER) {
+        value->v[value->count++] = (float)p->tok.number;
+        scene_next(p);
+        return true;
+    }
+    if (!scene_is_punct(p->tok, '(')) return scene_error(p, p->tok, "Expected a value");
+
+    scene_next(p);
+    for (;;) {
+        if (p->tok.kind != PHANIM_TOKEN_NUMBER) return scene_error(p, p->tok, "Expected a number");
+        if (value->count == 4) return scene_error(p, p->tok, "Tuples have at most 4 components");
+        value->v[value->count++] = (float)p->tok.number;
+        scene_next(p);
+        if (scene_is_punct(p->tok, ')')) break;
+        if (!scene_expect(p, ',')) return false;
+    }
+    scene_next(p);
+    return true;
+}
+
+// Colors are written with normalized components, like the Python scene writer does
+static Color scene_color(const float *v)
+{
+    u8 c[4];
+    for (size_t i = 0; i < 4; i++) {
+        c[i] = (u8)(Clamp(v[i], 0.0f, 1.0f) * 255.0f + 0.5f);
+    }
+    return (Color) { c[0], c[1], c[2], c[3] };
+}
+
+static bool scene_parse_object(SceneParser *p)
+{
+    #define KIND_BIT(kind) (1u << (kind))
+    #define ALL_KINDS (KIND_BIT(OK_LINE) | KIND_BIT(OK_RECT) | KIND_BIT(OK_CIRCLE) | KIND_BIT(OK_TEX))
+    static const struct { const char *name; ObjKind kind; } kinds[] = {
+        { "Line", OK_LINE }, { "Circle", OK_CIRCLE }, { "Rectangle", OK_RECT }, { "TexText", OK_TEX },
+    };
+    // Numeric fields are copied into SceneObject at `offset`. A count of 0 is a string.
+    // Rectangles accept a stroke for compatibility with the format but don't draw one.
+    static const struct { const char *name; int count; unsigned kinds; size_t offset; } fields[] = {
+        { "id",           1, ALL_KINDS,                                             offsetof(SceneObject, id) },
+        { "start",        2, KIND_BIT(OK_LINE),                                     offsetof(SceneObject, a) },
+        { "end",          2, KIND_BIT(OK_LINE),                                     offsetof(SceneObject, b) },
+        { "center",       2, KIND_BIT(OK_CIRCLE),                                   offsetof(SceneObject, a) },
+        { "top_left",     2, KIND_BIT(OK_RECT),                                     offsetof(SceneObject, a) },
+        { "position",     2, KIND_BIT(OK_TEX),                                      offsetof(SceneObject, a) },
+        { "radius",       1, KIND_BIT(OK_CIRCLE),                                   offsetof(SceneObject, radius) },
+        { "width",        1, KIND_BIT(OK_RECT),                                     offsetof(SceneObject, width) },
+        { "height",       1, KIND_BIT(OK_RECT),                                     offsetof(SceneObject, height) },
+        { "stroke_width", 1, KIND_BIT(OK_LINE) | KIND_BIT(OK_CIRCLE) | KIND_BIT(OK_RECT), offsetof(SceneObject, stroke_width) },
+        { "stroke_color", 4, KIND_BIT(OK_LINE) | KIND_BIT(OK_CIRCLE) | KIND_BIT(OK_RECT), offsetof(SceneObject, stroke) },
+        { "fill_color",   4, KIND_BIT(OK_CIRCLE) | KIND_BIT(OK_RECT),              offsetof(SceneObject, fill) },
+        { "font_size",    1, KIND_BIT(OK_TEX),                                      offsetof(SceneObject, font_size) },
+        { "text",         0, KIND_BIT(OK_TEX),                                      offsetof(SceneObject, text) },
+    };
+
+    PhanimToken kind_tok = p->tok;
+    SceneObject o = { .id = -1.0f };
+    size_t k = 0;
+    if (kind_tok.kind == PHANIM_TOKEN_IDENT) {
+        for (; k < sizeof(kinds) / sizeof(kinds[0]) && !scene_token_is(kind_tok, kinds[k].name); k++);
+    }
+    if (kind_tok.kind != PHANIM_TOKEN_IDENT || k == sizeof(kinds) / sizeof(kinds[0])) {
+        return scene_error(p, kind_tok, "Expected Line, Circle, Rectangle or TexText");
+    }
+    o.kind = kinds[k].kind;
+    scene_next(p);
+    if (!scene_expect(p, '{')) return false;
+
+    // `field: value` pairs separated by commas, a trailing one is allowed
+    while (!scene_is_punct(p->tok, '}')) {
+        PhanimToken name = p->tok;
+        size_t f = 0;
+        if (name.kind == PHANIM_TOKEN_IDENT) {
+            for (; f < sizeof(fields) / sizeof(fields[0]) && !scene_token_is(name, fields[f].name); f++);
+        }
+        if (name.kind != PHANIM_TOKEN_IDENT || f == sizeof(fields) / sizeof(fields[0])) {
+            return scene_error(p, name, "Expected a field");
+        }
+        if ((fields[f].kinds & KIND_BIT(o.kind)) == 0) {
+            return scene_error(p, name, "%s has no field '%s'", kinds[k].name, fields[f].name);
+        }
+        scene_next(p);
+        if (!scene_expect(p, ':')) return false;
+
+        SceneValue value;
+        if (!scene_parse_value(p, &value)) return false;
+        bool is_string = value.tok.kind == PHANIM_TOKEN_STRING;
+        if (fields[f].count == 0 ? !is_string : is_string || value.count != fields[f].count) {
+            const char *expected[] = { "a string", "a number", "(x, y)", "", "(r, g, b, a)" };
+            return scene_error(p, value.tok, "'%s' should be %s", fields[f].name, expected[fields[f].count]);
+        }
+        if (is_string) o.text = value.tok;
+        else memcpy((char *)&o + fields[f].offset, value.v, value.count * sizeof(float));
+
+        if (scene_is_punct(p->tok, '}')) break;
+        if (!scene_is_punct(p->tok, ',')) return scene_error(p, p->tok, "Expected ',' or '}'");
+        scene_next(p);
+    }
+    scene_next(p);
+    #undef KIND_BIT
+    #undef ALL_KINDS
+
+    if (o.id < 0.0f || o.id != floorf(o.id)) return scene_error(p, kind_tok, "Object needs an integer id");
+    size_t id = (size_t)o.id;
+    if (id > (1u << 24)) return scene_error(p, kind_tok, "Object ids should be small and dense");
+    if (id >= p->id_count) {
+        size_t count = p->id_count == 0 ? DEFAULT_INIT_CAP : p->id_count;
+        while (count <= id) count *= 2;
+        p->ids = arena_realloc(&CORE.temp_arena, p->ids, p->id_count * sizeof(*p->ids), count * sizeof(*p->ids));
+        p->pos = arena_realloc(&CORE.temp_arena, p->pos, p->id_count * sizeof(*p->pos), count * sizeof(*p->pos));
+        p->color = arena_realloc(&CORE.temp_arena, p->color, p->id_count * sizeof(*p->color), count * sizeof(*p->color));
+        for (size_t i = p->id_count; i < count; i++) p->ids[i] = SIZE_MAX;
+        p->id_count = count;
+    }
+    if (p->ids[id] != SIZE_MAX) return scene_error(p, kind_tok, "Object id %zu is used twice", id);
+
+    size_t obj = 0;
+    // Where actions move the object from, which is the center for rects
+    Vector2 pos = o.a;
+    Color fill = scene_color(o.fill);
+    Color stroke = scene_color(o.stroke);
+    switch (o.kind) {
+        case OK_LINE: {
+            obj = PhanimLine(o.a, o.b, stroke);
+            if (o.stroke_width > 0.0f) CORE.objs[obj].line.thickness = o.stroke_width;
+            p->color[id] = stroke;
+        } break;
+
+        case OK_RECT: {
+            // Files give the top left corner, PhanimRect() wants the center
+            Vector2 size = vec2(o.width, o.height);
+            pos = Vector2Add(o.a, Vector2Scale(size, 0.5f));
+            obj = PhanimRect(pos, size, fill);
+            p->color[id] = fill;
+        } break;
+
+        case OK_CIRCLE: {
+            obj = PhanimCircle(o.a, o.radius, fill);
+            CORE.objs[obj].circle.stroke_width = o.stroke_width;
+            CORE.objs[obj].circle.stroke_color = stroke;
+            p->color[id] = fill;
+        } break;
+
+        case OK_TEX: {
+            if (o.text.text == NULL) return scene_error(p, kind_tok, "TexText has no text");
+            // Copied into the scene's own arena, so the text goes away with the scene
+            // when it's replaced or fails to reload. The mapped file isn't NUL terminated.
+            char *text = arena_alloc(&CORE.obj_arena, o.text.len + 1);
+            memcpy(text, o.text.text, o.text.len);
+            text[o.text.len] = '\0';
+            PhanimStr str = { .text = text, .count = o.text.len, .capacity = o.text.len + 1 };
+            obj = PhanimTex(str, o.a);
+            if (o.font_size > 0.0f) CORE.objs[obj].tex.font_size = o.font_size;
+            p->color[id] = BLANK;
+        } break;
+
+        default: {
+            PHANIM_UNREACHABLE("Unknown object kind!");
+        } break;
+    }
+    CORE.base_objs[obj] = CORE.objs[obj];
+    p->ids[id] = obj;
+    p->pos[id] = pos;
+    return true;
+}
+
+// File id of the object an action argument refers to
+static bool scene_object_id(SceneParser *p, SceneValue *value, size_t *file_id)
+{
+    float id = value->v[0];
+    if (id < 0.0f || id >= (float)p->id_count || p->ids[(size_t)id] == SIZE_MAX) {
+        return scene_error(p, value->tok, "Unknown object id");
+    }
+    *file_id = (size_t)id;
+    return true;
+}
+
+static bool scene_animatable(SceneParser *p, SceneValue *value, size_t obj)
+{
+    if (CORE.objs[obj].kind == OK_TEX) return scene_error(p, value->tok, "TexText objects can only be created");
+    return true;
+}
+
+static bool scene_parse_action(SceneParser *p)
+{
+    typedef enum {
+        SA_POSITION_TRANSFORM,
+        SA_COLOR_FADE,
+        SA_SCALE,
+        SA_CREATE,
+        SA_PAUSE_SCENE,
+        SA_FADE_IN,
+        SA_FADE_OUT,
+        SA_SWAP_POSITION,
+        SA_SWAP_COLOR,
+        SA_DELAYED_START,
+    } SceneAction;
+    // One character per argument: o is an object id, n a number, v (x, y), c a color and
+    // s either a number or (x, y), depending on the object
+    static const struct { const char *name; const char *args; } actions[] = {
+        [SA_POSITION_TRANSFORM] = { "PositionTransform", "ovvn" },
+        [SA_COLOR_FADE]         = { "ColorFade",         "occn" },
+        [SA_SCALE]              = { "Scale",             "ossn" },
+        [SA_CREATE]             = { "Create",            "o" },
+        [SA_PAUSE_SCENE]        = { "PauseScene",        "n" },
+        [SA_FADE_IN]            = { "FadeIn",            "on" },
+        [SA_FADE_OUT]           = { "FadeOut",           "on" },
+        [SA_SWAP_POSITION]      = { "SwapPosition",      "oon" },
+        [SA_SWAP_COLOR]         = { "SwapColor",         "oon" },
+        [SA_DELAYED_START]      = { "DelayedStart",      "n" },
+    };
+    size_t action_count = sizeof(actions) / sizeof(actions[0]);
+
+    PhanimToken name = p->tok;
+    size_t k = 0;
+    if (name.kind == PHANIM_TOKEN_IDENT) {
+        for (; k < action_count && !scene_token_is(name, actions[k].name); k++);
+    }
+    if (name.kind != PHANIM_TOKEN_IDENT || k == action_count) return scene_error(p, name, "Expected an action");
+    scene_next(p);
+    if (!scene_expect(p, '(')) return false;
+
+    SceneValue args[4];
+    size_t argc = 0;
+    while (!scene_is_punct(p->tok, ')')) {
+        if (argc == 4) return scene_error(p, p->tok, "Too many arguments");
+        if (!scene_parse_value(p, &args[argc++])) return false;
+        if (scene_is_punct(p->tok, ')')) break;
+        if (!scene_is_punct(p->tok, ',')) return scene_error(p, p->tok, "Expected ',' or ')'");
+        scene_next(p);
+    }
+    scene_next(p);
+
+    const char *sig = actions[k].args;
+    if (argc != strlen(sig)) {
+        return scene_error(p, name, "%s takes %zu arguments, got %zu", actions[k].name, strlen(sig), argc);
+    }
+    size_t ids[2] = {0};
+    size_t objs[2] = {0};
+    size_t id_count = 0;
+    for (size_t i = 0; i < argc; i++) {
+        // Circles scale their radius, everything else its size
+        int want = sig[i] == 'v' ? 2 : (sig[i] == 'c' ? 4 : 1);
+        if (sig[i] == 's' && CORE.objs[objs[0]].kind != OK_CIRCLE) want = 2;
+        if (args[i].tok.kind == PHANIM_TOKEN_STRING || args[i].count != want) {
+            const char *expected[] = { "", "a number", "(x, y)", "", "(r, g, b, a)" };
+            return scene_error(
+                p, args[i].tok, "Argument %zu of %s should be %s", i + 1, actions[k].name,
+                sig[i] == 'o' ? "an object id" : expected[want]
+            );
+        }
+        if (sig[i] == 'o') {
+            if (!scene_object_id(p, &args[i], &ids[id_count])) return false;
+            objs[id_count] = p->ids[ids[id_count]];
+            id_count++;
+        }
+    }
+    if (k != SA_CREATE) {
+        for (size_t i = 0; i < id_count; i++) {
+            if (!scene_animatable(p, &args[i], objs[i])) return false;
+        }
+    }
+
+    // Actions that take a number always take it last
+    float duration = sig[argc - 1] == 'n' ? args[argc - 1].v[0] : 0.0f;
+    if (duration < 0.0f) return scene_error(p, args[argc - 1].tok, "Durations can't be negative");
+    switch ((SceneAction)k) {
+        case SA_POSITION_TRANSFORM: {
+            Vector2 start = vec2(args[1].v[0], args[1].v[1]);
+            Vector2 target = vec2(args[2].v[0], args[2].v[1]);
+            PhanimTransformPos(objs[0], start, target, duration);
+            p->pos[ids[0]] = target;
+        } break;
+
+        case SA_COLOR_FADE: {
+            Color start = scene_color(args[1].v);
+            Color target = scene_color(args[2].v);
+            PhanimFadeColor(objs[0], start, target, duration);
+            p->color[ids[0]] = target;
+        } break;
+
+        case SA_SCALE: {
+            if (args[1].count == 1) PhanimScaleSizeFloat(objs[0], args[1].v[0], args[2].v[0], duration);
+            else PhanimScaleSizeVec2(objs[0], vec2(args[1].v[0], args[1].v[1]), vec2(args[2].v[0], args[2].v[1]), duration);
+        } break;
+
+        case SA_CREATE: {
+            PhanimAddObject(objs[0]);
+        } break;
+
+        // DelayedStart delays whatever comes next, which is what a pause does
+        case SA_PAUSE_SCENE:
+        case SA_DELAYED_START: {
+            PhanimPause(duration);
+        } break;
+
+        case SA_FADE_IN: {
+            // Fades in to the object's color, or to opaque if it starts out invisible
+            Color target = p->color[ids[0]];
+            if (target.a == 0) target.a = 255;
+            Color start = target;
+            start.a = 0;
+            PhanimAddObject(objs[0]);
+            PhanimFadeColor(objs[0], start, target, duration);
+            p->color[ids[0]] = target;
+        } break;
+
+        case SA_FADE_OUT: {
+            Color start = p->color[ids[0]];
+            Color target = start;
+            target.a = 0;
+            PhanimFadeColor(objs[0], start, target, duration);
+            p->color[ids[0]] = target;
+        } break;
+
+        case SA_SWAP_POSITION: {
+            Vector2 a = p->pos[ids[0]], b = p->pos[ids[1]];
+            PhanimBeginGroup();
+            PhanimTransformPos(objs[0], a, b, duration);
+            PhanimTransformPos(objs[1], b, a, duration);
+            PhanimEndGroup();
+            p->pos[ids[0]] = b;
+            p->pos[ids[1]] = a;
+        } break;
+
+        case SA_SWAP_COLOR: {
+            Color a = p->color[ids[0]], b = p->color[ids[1]];
+            PhanimBeginGroup();
+            PhanimFadeColor(objs[0], a, b, duration);
+            PhanimFadeColor(objs[1], b, a, duration);
+            PhanimEndGroup();
+            p->color[ids[0]] = b;
+            p->color[ids[1]] = a;
+        } break;
+
+        default: {
+            PHANIM_UNREACHABLE("Unknown action!");
+        } break;
+    }
+    return true;
+}
+
+// Swaps the scene (objects, anims and everything derived from them) of CORE with
+// `other`'s. Renderer state and the tex cache stay where they are.
+static void scene_exchange(Phanim *other)
+{
+    #define SCENE_SWAP(field)                                           \
+        do {                                                            \
+            u8 tmp[sizeof(CORE.field)];                                 \
+            memcpy(tmp, &CORE.field, sizeof(tmp));                      \
+            memcpy(&CORE.field, &other->field, sizeof(tmp));            \
+            memcpy(&other->field, tmp, sizeof(tmp));                    \
+        } while (0)
+    SCENE_SWAP(obj_arena);
+    SCENE_SWAP(anim_arena);
+    SCENE_SWAP(time);
+    SCENE_SWAP(anims);
+    SCENE_SWAP(anim_count);
+    SCENE_SWAP(anim_capacity);
+    SCENE_SWAP(anim_current);
+    SCENE_SWAP(completed);
+    SCENE_SWAP(anim_starts);
+    SCENE_SWAP(total_time);
+    SCENE_SWAP(cursor);
+    SCENE_SWAP(group_end);
+    SCENE_SWAP(group_id);
+    SCENE_SWAP(group_count);
+    SCENE_SWAP(in_group);
+    SCENE_SWAP(float_track);
+    SCENE_SWAP(vec2_track);
+    SCENE_SWAP(color_track);
+    SCENE_SWAP(float_lanes);
+    SCENE_SWAP(vec2_lanes);
+    SCENE_SWAP(color_lanes);
+    SCENE_SWAP(active);
+    SCENE_SWAP(active_count);
+    SCENE_SWAP(bake);
+    SCENE_SWAP(objs);
+    SCENE_SWAP(base_objs);
+    SCENE_SWAP(obj_count);
+    SCENE_SWAP(obj_capacity);
+    SCENE_SWAP(scene_maps);
+    SCENE_SWAP(scene_size);
+    SCENE_SWAP(background);
+    #undef SCENE_SWAP
+}
+
+// Frees a scene that was swapped out of CORE with scene_exchange()
+static void scene_free(Phanim *scene)
+{
+    MemFree(scene->bake.frames);
+    MemFree(scene->bake.fields);
+    MemFree(scene->bake.render_from);
+    arena_free(&scene->obj_arena);
+    arena_free(&scene->anim_arena);
+    for (size_t i = 0; i < 2; i++) {
+        if (scene->scene_maps[i] != NULL) munmap(scene->scene_maps[i], scene->scene_size);
+    }
+}
+
+// Compares the initial state of two objects. Textures are filled in lazily, so tex
+// objects are compared by their source.
+static bool object_equal(const Object *a, const Object *b)
+{
+    if (a->kind != b->kind) return false;
+    switch (a->kind) {
+        case OK_LINE: {
+            return memcmp(&a->line, &b->line, sizeof(a->line)) == 0;
+        } break;
+
+        case OK_RECT: {
+            return memcmp(&a->rect, &b->rect, sizeof(a->rect)) == 0;
+        } break;
+
+        case OK_CIRCLE: {
+            return memcmp(&a->circle, &b->circle, sizeof(a->circle)) == 0;
+        } break;
+
+        case OK_TEX: {
+            const TexData *x = &a->tex, *y = &b->tex;
+            return x->text.count == y->text.count && memcmp(x->text.text, y->text.text, x->text.count) == 0
+                && x->font_size == y->font_size && x->scale == y->scale
+                && x->position.x == y->position.x && x->position.y == y->position.y;
+        } break;
+
+        default: {
+            PHANIM_UNREACHABLE("Unknown object kind!");
+        } break;
+    }
+    return false;
+}
+
+// Compares the value anim `a` of scene `sa` sets with the one of anim `b` of scene `sb`
+static bool anim_values_equal(const Phanim *sa, const Anim *a, const Phanim *sb, const Anim *b)
+{
+    if (a->slot == PHANIM_NO_SLOT || b->slot == PHANIM_NO_SLOT) return a->slot == b->slot;
+    #define TRACK_EQUAL(track)                                                                      \
+        (sa->track.dst[a->slot] == sb->track.dst[b->slot]                                           \
+         && memcmp(&sa->track.start[a->slot], &sb->track.start[b->slot], sizeof(*sa->track.start)) == 0  \
+         && memcmp(&sa->track.target[a->slot], &sb->track.target[b->slot], sizeof(*sa->track.target)) == 0)
+    bool equal = true;
+    switch (a->val_type) {
+        case AVT_FLOAT: {
+            equal = TRACK_EQUAL(float_track);
+        } break;
+
+        case AVT_VEC2: {
+            equal = TRACK_EQUAL(vec2_track);
+        } break;
+
+        case AVT_COLOR: {
+            equal = TRACK_EQUAL(color_track);
+        } break;
+
+        default: {
+        } break;
+    }
+    #undef TRACK_EQUAL
+    return equal;
+}
+
+// Counts the objects and anims of the current scene that differ from `old`'s, by
+// position in the tables. Tex objects that didn't change keep the textures `old`
+// already looked up, only changed sources get rasterized again.
+static void scene_diff(const Phanim *old, size_t *objs_changed, size_t *anims_changed)
+{
+    for (size_t i = 0; i < CORE.obj_count; i++) {
+        if (i >= old->obj_count || !object_equal(&CORE.base_objs[i], &old->base_objs[i])) {
+            (*objs_changed)++;
+            continue;
+        }
+        if (CORE.objs[i].kind == OK_TEX) {
+            CORE.objs[i].tex.texture = CORE.base_objs[i].tex.texture = old->objs[i].tex.texture;
+            CORE.objs[i].tex.image = CORE.base_objs[i].tex.image = old->objs[i].tex.image;
+        }
+    }
+    if (old->obj_count > CORE.obj_count) *objs_changed += old->obj_count - CORE.obj_count;
+    if (CORE.background.r != old->background.r || CORE.background.g != old->background.g
+        || CORE.background.b != old->background.b || CORE.background.a != old->background.a) {
+        (*objs_changed)++;
+    }
+
+    for (size_t i = 0; i < CORE.anim_count; i++) {
+        const Anim *a = &CORE.anims[i];
+        const Anim *b = i < old->anim_count ? &old->anims[i] : NULL;
+        bool equal = b != NULL && a->obj_id == b->obj_id && a->group == b->group && a->val_type == b->val_type
+            && a->kind == b->kind && a->duration == b->duration && a->func == b->func
+            && anim_values_equal(&CORE, a, old, b);
+        if (!equal) (*anims_changed)++;
+    }
+    if (old->anim_count > CORE.anim_count) *anims_changed += old->anim_count - CORE.anim_count;
+}
+
+static uint64_t profile_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+// Returns 0 while profiling is off, which profile_end() ignores
+static uint64_t profile_begin(void)
+{
+    return CORE.profile.enabled ? profile_now() : 0;
+}
+
+static void profile_end(PhanimPhase phase, uint64_t start)
+{
+    if (start == 0) return;
+    atomic_fetch_add(&CORE.profile.current[phase], profile_now() - start);
+}
+
+// Charges the time since the last switch to the run's phase and starts timing `phase`,
+// -1 stops timing. Only reads the clock when the phase actually changes.
+static void profile_run_switch(ProfileRun *run, int phase)
+{
+    if (!CORE.profile.enabled || run->phase == phase) return;
+    uint64_t now = profile_now();
+    if (run->phase >= 0) atomic_fetch_add(&CORE.profile.current[run->phase], now - run->since);
+    run->phase = phase;
+    run->since = now;
+}
+
+static int profile_compare(const void *a, const void *b)
+{
+    float x = *(const float *)a, y = *(const float *)b;
+    return (x > y) - (x < y);
+}
+
+#ifdef ARENA_STATS
+static Arena *arena_of(PhanimArena arena)
+{
+    switch (arena) {
+        case PA_OBJ: return &CORE.obj_arena;
+        case PA_ANIM: return &CORE.anim_arena;
+        case PA_TEMP: return &CORE.temp_arena;
+        case PA_TEX: return &CORE.tex_arena;
+        case PA_STR: return PhanimStrArena();
+        default: return NULL;
+    }
+}
+#endif // ARENA_STATS
+
+// Goes to stderr instead of TraceLog() since the tools turn down the log level, and a
+// build with ARENA_STATS asked for the report
+static void arena_log_stats(void)
+{
+#ifdef ARENA_STATS
+    fprintf(stderr, "%-5s %8s %8s %12s %12s %12s %8s %8s %12s %8s %12s %12s\n",
+        "arena", "allocs", "oversize", "requested", "reserved", "peak use", "regions",
+        "reallocs", "copied", "skipped", "skipped tail", "wasted now");
+    for (PhanimArena i = 0; i < PA_COUNT; i++) {
+        Arena_Stats s = arena_stats(arena_of(i));
+        fprintf(stderr, "%-5s %8zu %8zu %12zu %12zu %12zu %8zu %8zu %12zu %8zu %12zu %12zu\n",
+            PhanimArenaName(i), s.alloc_count, s.oversize_count, s.bytes_requested, s.bytes_reserved,
+            s.peak_bytes_in_use, s.region_count, s.realloc_count, s.realloc_copy_bytes,
+            s.regions_skipped, s.bytes_skipped, s.bytes_wasted);
+    }
+#endif // ARENA_STATS
+}
+
+static size_t make_anim(size_t id, AnimValType val_type, size_t slot, AnimKind kind, float duration)
+{
+    Anim a = {
+        .id = CORE.anim_count,
+        .obj_id = id,
+        .group = PHANIM_NO_GROUP,
+        .slot = slot,
+        .val_type = val_type,
+        .kind = kind,
+        .duration = duration,
+        .func = RF_CUBIC_SMOOTH_STEP
+    };
+
+    return phanim_add_anim(a);
+}
+
+static size_t phanim_add_anim(Anim anim)
+{
+    bake_drop();
+    if (CORE.anim_count >= CORE.anim_capacity) {
+        size_t new_cap = CORE.anim_capacity == 0 ? DEFAULT_INIT_CAP : CORE.anim_capacity*2;
+        CORE.anims = arena_realloc(&CORE.anim_arena, CORE.anims, CORE.anim_capacity * sizeof(*CORE.anims), new_cap * sizeof(*CORE.anims));
+        CORE.anim_starts = arena_realloc(&CORE.anim_arena, CORE.anim_starts, CORE.anim_capacity * sizeof(*CORE.anim_starts), new_cap * sizeof(*CORE.anim_starts));
+        // Worst case, every anim is active at once
+        CORE.active = arena_realloc(&CORE.anim_arena, CORE.active, CORE.anim_capacity * sizeof(*CORE.active), new_cap * sizeof(*CORE.active));
+        CORE.anim_capacity = new_cap;
+    }
+
+    size_t ind = CORE.anim_count;
+    CORE.anims[ind] = anim;
+    CORE.anim_starts[ind] = CORE.cursor;
+    if (CORE.in_group) {
+        CORE.anims[ind].group = CORE.group_id;
+        CORE.group_end = fmaxf(CORE.group_end, CORE.cursor + anim.duration);
+    } else {
+        CORE.anims[ind].group = PHANIM_NO_GROUP;
+        CORE.cursor += anim.duration;
+        CORE.group_end = CORE.cursor;
+    }
+    CORE.total_time = fmaxf(CORE.cursor, CORE.group_end);
+    CORE.anim_count++;
     return ind;
 }
 
 static size_t phanim_add_obj(Object obj)
 {
+    bake_drop();
     if (CORE.obj_count >= CORE.obj_capacity) {
         size_t new_cap = CORE.obj_capacity == 0 ? DEFAULT_INIT_CAP : CORE.obj_capacity*2;
         CORE.objs = arena_realloc(&CORE.obj_arena, CORE.objs, CORE.obj_capacity * sizeof(*CORE.objs), new_cap * sizeof(*CORE.objs));
+        CORE.base_objs = arena_realloc(&CORE.obj_arena, CORE.base_objs, CORE.obj_capacity * sizeof(*CORE.base_objs), new_cap * sizeof(*CORE.base_objs));
         CORE.obj_capacity = new_cap;
     }
 
     size_t ind = CORE.obj_count;
     CORE.objs[ind] = obj;
+    CORE.base_objs[ind] = obj;
     CORE.obj_count++;
+    obj_touch(ind);
     return ind;
 }
 
-static float rate_func(InterpFunc func, float anim_time, float duration)
+static void anim_apply(Anim *a, float anim_time)
 {
-    // Cubic and Quintic smooth step sources
-    //   - Source: https://en.wikipedia.org/wiki/Smoothstep
-    //   - Source: https://thebookofshaders.com/glossary/?search=smoothstep
-    float x = Clamp(anim_time / duration, 0.0f, 1.0f);
-    float val;
-    switch (func) {
-        case RF_LINEAR:
-            val = x;
-            break;
-        case RF_SINE:
-            // (-0.5 * cos(PI * x)) + 0.5
-            val = (-0.5f * cosf(PI * x)) + 0.5;
-            break;
-        case RF_SINE_PULSE:
-            // sin(PI * x)
-            val = sinf(PI * x);
-            break;
-        case RF_CUBIC_SMOOTH_STEP:
-            val = x * x * (3.0f - 2.0f * x);
-            break;
-        case RF_QUINTIC_SMOOTH_STEP:
-            val = x * x * x * (x * (6.0f * x - 15.0f) + 10.0f);
-            break;
-        default:
-            PHANIM_UNREACHABLE("Unknown rate function.");
-            break;
+    if (a->slot == PHANIM_NO_SLOT) {
+        // Pauses and immediate anims don't change any property
+        return;
     }
-    return val;
-}
+    float t = rate_func(a->func, anim_time, a->duration);
 
-static void anim_print(Anim *a)
-{
-    TraceLog(LOG_INFO, "Anim {");
     switch (a->val_type) {
-        case AVT_U8: {
-            TraceLog(LOG_INFO, "    obj: %d", *(u8*)a->ptr);
-            TraceLog(LOG_INFO, "    target: %d", *(u8*)a->target);
-            TraceLog(LOG_INFO, "    value type: u8 (unsigned char)");
-        } break;
-
         case AVT_FLOAT: {
-            TraceLog(LOG_INFO, "    obj: %.2f", *(float*)a->ptr);
-            TraceLog(LOG_INFO, "    target: %.2f", *(float*)a->target);
-            TraceLog(LOG_INFO, "    value type: float");
+            FloatTrack *track = &CORE.float_track;
+            *obj_field_ptr(float, track->dst[a->slot]) = Lerp(track->start[a->slot], track->target[a->slot], t);
         } break;
 
         case AVT_VEC2: {
-            Vector2 ptr = *(Vector2*)a->ptr;
-            Vector2 target = *(Vector2*)a->target;
-            TraceLog(LOG_INFO, "    obj: (%.2f, %.2f)", ptr.x, ptr.y);
-            TraceLog(LOG_INFO, "    target: (%.2f, %.2f)", target.x, target.y);
-            TraceLog(LOG_INFO, "    value type: Vector2");
+            Vec2Track *track = &CORE.vec2_track;
+            *obj_field_ptr(Vector2, track->dst[a->slot]) = Vector2Lerp(track->start[a->slot], track->target[a->slot], t);
         } break;
 
         case AVT_COLOR: {
-            Color ptr = *(Color*)a->ptr;
-            Color target = *(Color*)a->target;
-            TraceLog(LOG_INFO, "    obj: (%d, %d, %d, %d)", ptr.r, ptr.g, ptr.b, ptr.a);
-            TraceLog(LOG_INFO, "    target: (%d, %d, %d, %d)", target.r, target.g, target.b, target.a);
-            TraceLog(LOG_INFO, "    value type: Color");
+            ColorTrack *track = &CORE.color_track;
+            *obj_field_ptr(Color, track->dst[a->slot]) = PhanimColorLerp(track->start[a->slot], track->target[a->slot], t);
         } break;
 
         default: {
-            PHANIM_UNREACHABLE("Unknown anim value type");
+            PHANIM_UNREACHABLE("Unknown anim value type!");
         } break;
     }
-    TraceLog(LOG_INFO, "    time: %.2f", a->anim_time);
+}
+
+static void timeline_rebuild(size_t from)
+{
+    // Start from the beginning of the group `from` is in, if any. Nothing before that
+    // can end after it starts.
+    while (from > 0 && from < CORE.anim_count && CORE.anims[from].group != PHANIM_NO_GROUP
+        && CORE.anims[from - 1].group == CORE.anims[from].group) {
+        from--;
+    }
+    if (from >= CORE.anim_count) return;
+
+    float cursor = CORE.anim_starts[from];
+    float group_end = cursor;
+    size_t group = PHANIM_NO_GROUP;
+    for (size_t i = from; i < CORE.anim_count; i++) {
+        Anim *a = &CORE.anims[i];
+        if (a->group != group) {
+            // A group only moves the cursor once it's over
+            cursor = fmaxf(cursor, group_end);
+            group_end = cursor;
+            group = a->group;
+        }
+
+        CORE.anim_starts[i] = cursor;
+        float end = cursor + a->duration;
+        if (group == PHANIM_NO_GROUP) {
+            cursor = end;
+            group_end = end;
+        } else {
+            group_end = fmaxf(group_end, end);
+        }
+    }
+
+    if (CORE.in_group && group == CORE.group_id) {
+        CORE.cursor = cursor;
+    } else {
+        CORE.cursor = fmaxf(cursor, group_end);
+        group_end = CORE.cursor;
+    }
+    CORE.group_end = group_end;
+    CORE.total_time = fmaxf(CORE.cursor, CORE.group_end);
+}
+
+static float rate_func(InterpFunc func, float anim_time, float duration)
+{
+    // Same easing the batched kernels use, so seeking lands on the exact same values
+    float x = duration > 0.0f ? Clamp(anim_time / duration, 0.0f, 1.0f) : 1.0f;
+    return PhanimEase(func, x);
+}
+
+static void anim_print(Anim *a)
+{
+    TraceLog(LOG_INFO, "Anim {");
+    if (a->slot == PHANIM_NO_SLOT) {
+        TraceLog(LOG_INFO, "    value type: none");
+    } else {
+        switch (a->val_type) {
+            case AVT_FLOAT: {
+                FloatTrack *track = &CORE.float_track;
+                TraceLog(LOG_INFO, "    obj: %.2f", *obj_field_ptr(float, track->dst[a->slot]));
+                TraceLog(LOG_INFO, "    target: %.2f", track->target[a->slot]);
+                TraceLog(LOG_INFO, "    value type: float");
+            } break;
+
+            case AVT_VEC2: {
+                Vector2 ptr = *obj_field_ptr(Vector2, CORE.vec2_track.dst[a->slot]);
+                Vector2 target = CORE.vec2_track.target[a->slot];
+                TraceLog(LOG_INFO, "    obj: (%.2f, %.2f)", ptr.x, ptr.y);
+                TraceLog(LOG_INFO, "    target: (%.2f, %.2f)", target.x, target.y);
+                TraceLog(LOG_INFO, "    value type: Vector2");
+            } break;
+
+            case AVT_COLOR: {
+                Color ptr = *obj_field_ptr(Color, CORE.color_track.dst[a->slot]);
+                Color target = CORE.color_track.target[a->slot];
+                TraceLog(LOG_INFO, "    obj: (%d, %d, %d, %d)", ptr.r, ptr.g, ptr.b, ptr.a);
+                TraceLog(LOG_INFO, "    target: (%d, %d, %d, %d)", target.r, target.g, target.b, target.a);
+                TraceLog(LOG_INFO, "    value type: Color");
+            } break;
+
+            default: {
+                PHANIM_UNREACHABLE("Unknown anim value type");
+            } break;
+        }
+    }
+    TraceLog(LOG_INFO, "    start: %.2f", CORE.anim_starts[a->id]);
     TraceLog(LOG_INFO, "    duration: %.2f", a->duration);
     TraceLog(LOG_INFO, "}");
 }
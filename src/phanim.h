@@ -46,6 +46,42 @@ typedef enum {
     AK_IMMEDIATE,
 } AnimKind;
 
+typedef enum {
+    RB_RAYLIB,
+    RB_CPU,
+} RenderBackend;
+
+// Phases PhanimSetProfiling() measures. The render phases follow the order of ObjKind.
+typedef enum {
+    PP_UPDATE,
+    PP_RENDER_LINE,
+    PP_RENDER_RECT,
+    PP_RENDER_CIRCLE,
+    PP_RENDER_TEX,
+    // Culling, binning objects into tiles with the CPU backend, submitting batches
+    // with raylib and copying the static layer
+    PP_RENDER_BIN,
+    // Compiling and rasterizing tex sources that aren't cached yet
+    PP_TEX_RASTER,
+    // Reported by exporters with PhanimProfileAdd()
+    PP_READBACK,
+    PP_ENCODE,
+    // Wall time between two calls to PhanimProfileFrameEnd()
+    PP_FRAME,
+    PP_COUNT,
+} PhanimPhase;
+
+// Arenas phanim allocates from, for PhanimArenaStats()
+typedef enum {
+    PA_OBJ,
+    PA_ANIM,
+    PA_TEMP,
+    PA_TEX,
+    // The one PhanimStr allocates from
+    PA_STR,
+    PA_COUNT,
+} PhanimArena;
+
 typedef enum {
     AVT_U8,
     AVT_FLOAT,
@@ -77,7 +113,12 @@ typedef struct {
 typedef struct {
     PhanimStr text;
     float font_size;
+    float scale;
     Vector2 position;
+    // Filled in lazily from the tex cache the first time the object is rendered.
+    // `texture` is used by the raylib backend and `image` by the CPU one.
+    Texture texture;
+    Image image;
 } TexData;
 
 typedef struct {
@@ -93,11 +134,28 @@ typedef struct {
 } Object;
 
 void PhanimInit(void);
+// With RB_CPU, PhanimRender() draws into a `width` x `height` framebuffer in memory
+// instead of through raylib, so no window or GL context is needed
+void PhanimInitEx(RenderBackend backend, int width, int height);
 void PhanimDeinit(void);
+RenderBackend PhanimGetBackend(void);
+// Number of threads the CPU backend rasterizes with, 0 (the default) uses one per core
+void PhanimSetRenderThreads(size_t count);
+// Whether PhanimRender() keeps the objects that haven't changed for a few frames in a
+// static layer and only redraws the ones after the first object that did (on by
+// default). With raylib, the layer also holds whatever was drawn before PhanimRender()
+// in the same frame, so turn it off if that changes while the background stays the same.
+void PhanimSetStaticLayer(bool enabled);
+// Top to bottom RGBA8 rows of the last frame drawn by the CPU backend
+Color *PhanimGetFramebuffer(void);
+void PhanimPrepareTex(void);
 float PhanimGetTime(void);
 size_t PhanimCurrentAnimId(void);
 size_t PhanimAnimCount(void);
 float PhanimTotalAnimTime(void);
+// Id of the anim playing at `time`, found in O(log n)
+size_t PhanimAnimAtTime(float time);
+float PhanimAnimStartTime(size_t id);
 Color PhanimGetBackground(void);
 void PhanimSetBackground(Color color);
 
@@ -105,15 +163,69 @@ size_t PhanimCircle(Vector2 center, float radius, Color color);
 size_t PhanimLine(Vector2 start, Vector2 end, Color color);
 size_t PhanimRect(Vector2 pos, Vector2 size, Color color);
 size_t PhanimTex(PhanimStr str, Vector2 pos);
+// Outlines a circle with a stroke `width` wide, centered on its edge
+void PhanimSetStroke(size_t id, float width, Color color);
 
 void PhanimChangeInterpFunc(size_t id, InterpFunc func);
+void PhanimChangeDuration(size_t id, float duration);
 
 void PhanimTransformPos(size_t id, Vector2 start, Vector2 target, float duration);
 void PhanimFadeColor(size_t id, Color start, Color target, float duration);
 size_t PhanimScaleSizeFloat(size_t id, float start, float target, float duration);
 size_t PhanimScaleSizeVec2(size_t id, Vector2 start, Vector2 target, float duration);
+// Every anim added between these two calls starts at the same time. The next anim
+// after the group starts once the longest one in it is over.
+void PhanimBeginGroup(void);
+void PhanimEndGroup(void);
 void PhanimPause(float duration);
 void PhanimAddObject(size_t id);
 
 void PhanimUpdate(float dt);
+// Jumps to any point of the timeline, forwards or backwards. Only finding the anim
+// playing at `time` is O(log n): the objects are reset to their initial state and every
+// anim that started before `time` is applied again, so a seek costs O(objects + anims).
+void PhanimSeek(float time);
+// Samples every animated property at `fps` into one buffer. From then on, updating
+// and seeking only copy the nearest sampled frame back into the objects. Changing the
+// scene drops the baked frames. Leaves the timeline at its start.
+void PhanimBake(float fps);
+bool PhanimIsBaked(void);
+// Writes the scene as it was built (objects in their initial state, anims and their
+// values) to a compiled scene file
+bool PhanimSaveScene(const char *path);
+// Maps a compiled scene file and uses its tables in place. Only works on an empty
+// scene and with a file written by a build with the same memory layout.
+bool PhanimLoadScene(const char *path);
+// Builds the scene described by a textual .phanim file (see file-spec/file-format.txt).
+// Only works on an empty scene, which stays empty if the file has an error.
+bool PhanimLoadSceneText(const char *path);
+// Replaces the scene with the one in `path` (compiled, or textual if it ends in .phanim)
+// and continues at the same time. Nothing changes if it fails to load.
+bool PhanimReloadScene(const char *path);
+// Times every phase of every frame. With the CPU backend, the render phases add up the
+// time of every rasterizer thread. With raylib they only cover the CPU side of drawing.
+void PhanimSetProfiling(bool enabled);
+bool PhanimIsProfiling(void);
+// Adds time spent outside of phanim, like reading a frame back, to the current frame
+void PhanimProfileAdd(PhanimPhase phase, double seconds);
+// Closes the current frame: its times go into the history and the dump, if any
+void PhanimProfileFrameEnd(void);
+// Appends one line per frame to `path`, as JSON objects if it ends in .json and as CSV
+// otherwise. The file stays open across fork(), so workers can share it.
+bool PhanimProfileDump(const char *path);
+const char *PhanimPhaseName(PhanimPhase phase);
+// Number of frames in the history, which keeps the last few seconds
+size_t PhanimProfileFrameCount(void);
+// Milliseconds `phase` took `ago` frames before the last one
+float PhanimProfileGet(PhanimPhase phase, size_t ago);
+// Percentile `p` (0 to 100) of `phase` over the history, in milliseconds
+float PhanimProfilePercentile(PhanimPhase phase, float p);
+// Counters of one of the arenas. They are only collected when everything is built with
+// ARENA_STATS defined, otherwise this returns false. With ARENA_STATS, PhanimDeinit()
+// also logs them for every arena.
+bool PhanimArenaStats(PhanimArena arena, Arena_Stats *stats);
+const char *PhanimArenaName(PhanimArena arena);
+// Whether anything that's drawn may have changed since the last PhanimRender(). If it
+// returns false, the next frame would come out exactly like the last one.
+bool PhanimFrameChanged(void);
 void PhanimRender(void);
@@ -0,0 +1,421 @@
+#ifndef __PHKERNELS_H__
+#define __PHKERNELS_H__
+
+#include "phanim.h"
+
+// Batched interpolation kernels used to update playing anims. Every kernel has a
+// scalar version and, on x86-64, SSE2 and AVX2 versions that process 4 or 8 anims
+// at once. The fastest one the CPU supports is picked by PhanimKernelsInit().
+//
+// All versions do the exact same float operations in the same order, so their
+// results are bit identical. Seeking uses the scalar ones and still lands on the
+// same values as playing the timeline.
+
+// Returns the name of the selected instruction set, e.g. "AVX2"
+const char *PhanimKernelsInit(void);
+
+// Eased progress of one anim, `x` is its normalized time in [0, 1]
+float PhanimEase(InterpFunc func, float x);
+Color PhanimColorLerp(Color start, Color target, float t);
+
+// `t[i]` = eased progress of anim `i` at `time`, given when it begins and its duration
+void PhanimKernelRates(const InterpFunc *func, const float *begin, const float *duration, float time, float *t, size_t count);
+void PhanimKernelLerpFloat(const float *start, const float *target, const float *t, float *out, size_t count);
+void PhanimKernelLerpVec2(const Vector2 *start, const Vector2 *target, const float *t, Vector2 *out, size_t count);
+void PhanimKernelLerpColor(const Color *start, const Color *target, const float *t, Color *out, size_t count);
+
+#endif // __PHKERNELS_H__
+
+#ifdef PHANIM_KERNELS_IMPLEMENTATION
+#include <math.h>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+    #define PHANIM_KERNELS_X86
+    #include <immintrin.h>
+#endif
+
+// sin(PI * u) for u in [-0.5, 0.5]. The Taylor series of sin up to z^11 is already
+// within float precision on [-PI/2, PI/2].
+#define KERNEL_SIN_C3  (-1.0f/6.0f)
+#define KERNEL_SIN_C5  (1.0f/120.0f)
+#define KERNEL_SIN_C7  (-1.0f/5040.0f)
+#define KERNEL_SIN_C9  (1.0f/362880.0f)
+#define KERNEL_SIN_C11 (-1.0f/39916800.0f)
+
+static inline float kernel_sin_pi(float u)
+{
+    float z = PI * u;
+    float z2 = z * z;
+    float p = KERNEL_SIN_C9 + z2 * KERNEL_SIN_C11;
+    p = KERNEL_SIN_C7 + z2 * p;
+    p = KERNEL_SIN_C5 + z2 * p;
+    p = KERNEL_SIN_C3 + z2 * p;
+    p = 1.0f + z2 * p;
+    return z * p;
+}
+
+static inline float kernel_progress(float begin, float duration, float time)
+{
+    if (!(duration > 0.0f)) return 1.0f;
+    float x = (time - begin) / duration;
+    x = x > 0.0f ? x : 0.0f;
+    return x < 1.0f ? x : 1.0f;
+}
+
+float PhanimEase(InterpFunc func, float x)
+{
+    // Cubic and Quintic smooth step sources
+    //   - Source: https://en.wikipedia.org/wiki/Smoothstep
+    //   - Source: https://thebookofshaders.com/glossary/?search=smoothstep
+    switch (func) {
+        case RF_LINEAR:
+            return x;
+        case RF_SINE:
+            // (-0.5 * cos(PI * x)) + 0.5, with cos(PI * x) = sin(PI * (0.5 - x))
+            return 0.5f - 0.5f * kernel_sin_pi(0.5f - x);
+        case RF_SINE_PULSE:
+            // sin(PI * x), folded around x = 0.5
+            return kernel_sin_pi(0.5f - fabsf(x - 0.5f));
+        case RF_CUBIC_SMOOTH_STEP:
+            return x * x * (3.0f - 2.0f * x);
+        case RF_QUINTIC_SMOOTH_STEP:
+            return x * x * x * (x * (6.0f * x - 15.0f) + 10.0f);
+        default:
+            PHANIM_UNREACHABLE("Unknown rate function.");
+            break;
+    }
+    return x;
+}
+
+// Same as raylib's ColorLerp()
+Color PhanimColorLerp(Color start, Color target, float t)
+{
+    t = t > 0.0f ? t : 0.0f;
+    t = t < 1.0f ? t : 1.0f;
+    float s = 1.0f - t;
+    return (Color) {
+        (unsigned char)(s * start.r + t * target.r),
+        (unsigned char)(s * start.g + t * target.g),
+        (unsigned char)(s * start.b + t * target.b),
+        (unsigned char)(s * start.a + t * target.a),
+    };
+}
+
+static void rates_scalar(const InterpFunc *func, const float *begin, const float *duration, float time, float *t, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        t[i] = PhanimEase(func[i], kernel_progress(begin[i], duration[i], time));
+    }
+}
+
+static void lerp_float_scalar(const float *start, const float *target, const float *t, float *out, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        out[i] = start[i] + t[i] * (target[i] - start[i]);
+    }
+}
+
+static void lerp_vec2_scalar(const Vector2 *start, const Vector2 *target, const float *t, Vector2 *out, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        out[i].x = start[i].x + t[i] * (target[i].x - start[i].x);
+        out[i].y = start[i].y + t[i] * (target[i].y - start[i].y);
+    }
+}
+
+static void lerp_color_scalar(const Color *start, const Color *target, const float *t, Color *out, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        out[i] = PhanimColorLerp(start[i], target[i], t[i]);
+    }
+}
+
+#ifdef PHANIM_KERNELS_X86
+static inline __m128 kernel_sin_pi_sse2(__m128 u)
+{
+    __m128 z = _mm_mul_ps(_mm_set1_ps(PI), u);
+    __m128 z2 = _mm_mul_ps(z, z);
+    __m128 p = _mm_add_ps(_mm_set1_ps(KERNEL_SIN_C9), _mm_mul_ps(z2, _mm_set1_ps(KERNEL_SIN_C11)));
+    p = _mm_add_ps(_mm_set1_ps(KERNEL_SIN_C7), _mm_mul_ps(z2, p));
+    p = _mm_add_ps(_mm_set1_ps(KERNEL_SIN_C5), _mm_mul_ps(z2, p));
+    p = _mm_add_ps(_mm_set1_ps(KERNEL_SIN_C3), _mm_mul_ps(z2, p));
+    p = _mm_add_ps(_mm_set1_ps(1.0f), _mm_mul_ps(z2, p));
+    return _mm_mul_ps(z, p);
+}
+
+// SSE2 has no blendv, so the lanes are selected with bit masks
+static inline __m128 kernel_select_sse2(__m128 mask, __m128 a, __m128 b)
+{
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+static inline __m128 kernel_ease_sse2(int func, __m128 x)
+{
+    const __m128 half = _mm_set1_ps(0.5f);
+    switch (func) {
+        case RF_SINE:
+            return _mm_sub_ps(half, _mm_mul_ps(half, kernel_sin_pi_sse2(_mm_sub_ps(half, x))));
+        case RF_SINE_PULSE: {
+            __m128 dist = _mm_and_ps(_mm_sub_ps(x, half), _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff)));
+            return kernel_sin_pi_sse2(_mm_sub_ps(half, dist));
+        }
+        case RF_CUBIC_SMOOTH_STEP:
+            return _mm_mul_ps(_mm_mul_ps(x, x), _mm_sub_ps(_mm_set1_ps(3.0f), _mm_mul_ps(_mm_set1_ps(2.0f), x)));
+        case RF_QUINTIC_SMOOTH_STEP: {
+            __m128 poly = _mm_add_ps(_mm_mul_ps(x, _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(6.0f), x), _mm_set1_ps(15.0f))), _mm_set1_ps(10.0f));
+            return _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(x, x), x), poly);
+        }
+        default:
+            return x;
+    }
+}
+
+static void rates_sse2(const InterpFunc *func, const float *begin, const float *duration, float time, float *t, size_t count)
+{
+    const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i f = _mm_loadu_si128((const __m128i *)&func[i]);
+        __m128 d = _mm_loadu_ps(&duration[i]);
+        __m128 x = _mm_div_ps(_mm_sub_ps(_mm_set1_ps(time), _mm_loadu_ps(&begin[i])), d);
+        x = _mm_min_ps(_mm_max_ps(x, zero), one);
+        x = kernel_select_sse2(_mm_cmpngt_ps(d, zero), one, x);
+
+        // Every rate function is only evaluated when at least one of the lanes uses it
+        __m128 val = x;
+        int handled = 0;
+        for (int k = RF_LINEAR; k <= RF_QUINTIC_SMOOTH_STEP; k++) {
+            __m128 mask = _mm_castsi128_ps(_mm_cmpeq_epi32(f, _mm_set1_epi32(k)));
+            int bits = _mm_movemask_ps(mask);
+            if (bits == 0) continue;
+            handled |= bits;
+            val = kernel_select_sse2(mask, kernel_ease_sse2(k, x), val);
+        }
+        if (handled != 0xf) {
+            // Let the scalar path report the unknown function
+            rates_scalar(&func[i], &begin[i], &duration[i], time, &t[i], 4);
+            continue;
+        }
+        _mm_storeu_ps(&t[i], val);
+    }
+    rates_scalar(&func[i], &begin[i], &duration[i], time, &t[i], count - i);
+}
+
+static void lerp_float_sse2(const float *start, const float *target, const float *t, float *out, size_t count)
+{
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 s = _mm_loadu_ps(&start[i]);
+        __m128 e = _mm_loadu_ps(&target[i]);
+        _mm_storeu_ps(&out[i], _mm_add_ps(s, _mm_mul_ps(_mm_loadu_ps(&t[i]), _mm_sub_ps(e, s))));
+    }
+    lerp_float_scalar(&start[i], &target[i], &t[i], &out[i], count - i);
+}
+
+static void lerp_vec2_sse2(const Vector2 *start, const Vector2 *target, const float *t, Vector2 *out, size_t count)
+{
+    // Vector2 arrays are interleaved x, y pairs, so every t is used twice
+    const float *s = (const float *)start, *e = (const float *)target;
+    float *o = (float *)out;
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 tv = _mm_loadu_ps(&t[i]);
+        __m128 t_lo = _mm_unpacklo_ps(tv, tv), t_hi = _mm_unpackhi_ps(tv, tv);
+        __m128 s_lo = _mm_loadu_ps(&s[2*i]), s_hi = _mm_loadu_ps(&s[2*i + 4]);
+        __m128 e_lo = _mm_loadu_ps(&e[2*i]), e_hi = _mm_loadu_ps(&e[2*i + 4]);
+        _mm_storeu_ps(&o[2*i], _mm_add_ps(s_lo, _mm_mul_ps(t_lo, _mm_sub_ps(e_lo, s_lo))));
+        _mm_storeu_ps(&o[2*i + 4], _mm_add_ps(s_hi, _mm_mul_ps(t_hi, _mm_sub_ps(e_hi, s_hi))));
+    }
+    lerp_vec2_scalar(&start[i], &target[i], &t[i], &out[i], count - i);
+}
+
+static void lerp_color_sse2(const Color *start, const Color *target, const float *t, Color *out, size_t count)
+{
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 tv = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(&t[i]), _mm_setzero_ps()), _mm_set1_ps(1.0f));
+        __m128 sv = _mm_sub_ps(_mm_set1_ps(1.0f), tv);
+        float tf[4], sf[4];
+        _mm_storeu_ps(tf, tv);
+        _mm_storeu_ps(sf, sv);
+        __m128i s8 = _mm_loadu_si128((const __m128i *)&start[i]);
+        __m128i e8 = _mm_loadu_si128((const __m128i *)&target[i]);
+        __m128i s16[2] = { _mm_unpacklo_epi8(s8, zero), _mm_unpackhi_epi8(s8, zero) };
+        __m128i e16[2] = { _mm_unpacklo_epi8(e8, zero), _mm_unpackhi_epi8(e8, zero) };
+        __m128i res[4];
+        for (int c = 0; c < 4; c++) {
+            // One color per iteration, its weights broadcast to all four channels
+            __m128i sc = (c & 1) ? _mm_unpackhi_epi16(s16[c/2], zero) : _mm_unpacklo_epi16(s16[c/2], zero);
+            __m128i ec = (c & 1) ? _mm_unpackhi_epi16(e16[c/2], zero) : _mm_unpacklo_epi16(e16[c/2], zero);
+            __m128 v = _mm_add_ps(
+                _mm_mul_ps(_mm_set1_ps(sf[c]), _mm_cvtepi32_ps(sc)),
+                _mm_mul_ps(_mm_set1_ps(tf[c]), _mm_cvtepi32_ps(ec)));
+            res[c] = _mm_cvttps_epi32(v);
+        }
+        __m128i lo = _mm_packs_epi32(res[0], res[1]), hi = _mm_packs_epi32(res[2], res[3]);
+        _mm_storeu_si128((__m128i *)&out[i], _mm_packus_epi16(lo, hi));
+    }
+    lerp_color_scalar(&start[i], &target[i], &t[i], &out[i], count - i);
+}
+
+#define KERNEL_AVX2 __attribute__((target("avx2")))
+
+KERNEL_AVX2 static inline __m256 kernel_sin_pi_avx2(__m256 u)
+{
+    __m256 z = _mm256_mul_ps(_mm256_set1_ps(PI), u);
+    __m256 z2 = _mm256_mul_ps(z, z);
+    __m256 p = _mm256_add_ps(_mm256_set1_ps(KERNEL_SIN_C9), _mm256_mul_ps(z2, _mm256_set1_ps(KERNEL_SIN_C11)));
+    p = _mm256_add_ps(_mm256_set1_ps(KERNEL_SIN_C7), _mm256_mul_ps(z2, p));
+    p = _mm256_add_ps(_mm256_set1_ps(KERNEL_SIN_C5), _mm256_mul_ps(z2, p));
+    p = _mm256_add_ps(_mm256_set1_ps(KERNEL_SIN_C3), _mm256_mul_ps(z2, p));
+    p = _mm256_add_ps(_mm256_set1_ps(1.0f), _mm256_mul_ps(z2, p));
+    return _mm256_mul_ps(z, p);
+}
+
+KERNEL_AVX2 static inline __m256 kernel_ease_avx2(int func, __m256 x)
+{
+    const __m256 half = _mm256_set1_ps(0.5f);
+    switch (func) {
+        case RF_SINE:
+            return _mm256_sub_ps(half, _mm256_mul_ps(half, kernel_sin_pi_avx2(_mm256_sub_ps(half, x))));
+        case RF_SINE_PULSE: {
+            __m256 dist = _mm256_and_ps(_mm256_sub_ps(x, half), _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff)));
+            return kernel_sin_pi_avx2(_mm256_sub_ps(half, dist));
+        }
+        case RF_CUBIC_SMOOTH_STEP:
+            return _mm256_mul_ps(_mm256_mul_ps(x, x), _mm256_sub_ps(_mm256_set1_ps(3.0f), _mm256_mul_ps(_mm256_set1_ps(2.0f), x)));
+        case RF_QUINTIC_SMOOTH_STEP: {
+            __m256 poly = _mm256_add_ps(_mm256_mul_ps(x, _mm256_sub_ps(_mm256_mul_ps(_mm256_set1_ps(6.0f), x), _mm256_set1_ps(15.0f))), _mm256_set1_ps(10.0f));
+            return _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(x, x), x), poly);
+        }
+        default:
+            return x;
+    }
+}
+
+KERNEL_AVX2 static void rates_avx2(const InterpFunc *func, const float *begin, const float *duration, float time, float *t, size_t count)
+{
+    const __m256 zero = _mm256_setzero_ps(), one = _mm256_set1_ps(1.0f);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i f = _mm256_loadu_si256((const __m256i *)&func[i]);
+        __m256 d = _mm256_loadu_ps(&duration[i]);
+        __m256 x = _mm256_div_ps(_mm256_sub_ps(_mm256_set1_ps(time), _mm256_loadu_ps(&begin[i])), d);
+        x = _mm256_min_ps(_mm256_max_ps(x, zero), one);
+        x = _mm256_blendv_ps(x, one, _mm256_cmp_ps(d, zero, _CMP_NGT_UQ));
+
+        __m256 val = x;
+        int handled = 0;
+        for (int k = RF_LINEAR; k <= RF_QUINTIC_SMOOTH_STEP; k++) {
+            __m256 mask = _mm256_castsi256_ps(_mm256_cmpeq_epi32(f, _mm256_set1_epi32(k)));
+            int bits = _mm256_movemask_ps(mask);
+            if (bits == 0) continue;
+            handled |= bits;
+            val = _mm256_blendv_ps(val, kernel_ease_avx2(k, x), mask);
+        }
+        if (handled != 0xff) {
+            rates_scalar(&func[i], &begin[i], &duration[i], time, &t[i], 8);
+            continue;
+        }
+        _mm256_storeu_ps(&t[i], val);
+    }
+    rates_scalar(&func[i], &begin[i], &duration[i], time, &t[i], count - i);
+}
+
+KERNEL_AVX2 static void lerp_float_avx2(const float *start, const float *target, const float *t, float *out, size_t count)
+{
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 s = _mm256_loadu_ps(&start[i]);
+        __m256 e = _mm256_loadu_ps(&target[i]);
+        _mm256_storeu_ps(&out[i], _mm256_add_ps(s, _mm256_mul_ps(_mm256_loadu_ps(&t[i]), _mm256_sub_ps(e, s))));
+    }
+    lerp_float_scalar(&start[i], &target[i], &t[i], &out[i], count - i);
+}
+
+KERNEL_AVX2 static void lerp_vec2_avx2(const Vector2 *start, const Vector2 *target, const float *t, Vector2 *out, size_t count)
+{
+    const float *s = (const float *)start, *e = (const float *)target;
+    float *o = (float *)out;
+    const __m256i dup = _mm256_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256 tv = _mm256_permutevar8x32_ps(_mm256_castps128_ps256(_mm_loadu_ps(&t[i])), dup);
+        __m256 sv = _mm256_loadu_ps(&s[2*i]);
+        __m256 ev = _mm256_loadu_ps(&e[2*i]);
+        _mm256_storeu_ps(&o[2*i], _mm256_add_ps(sv, _mm256_mul_ps(tv, _mm256_sub_ps(ev, sv))));
+    }
+    lerp_vec2_scalar(&start[i], &target[i], &t[i], &out[i], count - i);
+}
+
+KERNEL_AVX2 static void lerp_color_avx2(const Color *start, const Color *target, const float *t, Color *out, size_t count)
+{
+    // Two colors per iteration, each channel widened to a float lane
+    const __m256i dup = _mm256_setr_epi32(0, 0, 0, 0, 1, 1, 1, 1);
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        __m256 tv = _mm256_castps128_ps256(_mm_castpd_ps(_mm_load_sd((const double *)&t[i])));
+        tv = _mm256_permutevar8x32_ps(tv, dup);
+        tv = _mm256_min_ps(_mm256_max_ps(tv, _mm256_setzero_ps()), _mm256_set1_ps(1.0f));
+        __m256 sv = _mm256_sub_ps(_mm256_set1_ps(1.0f), tv);
+        __m256 s = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)&start[i])));
+        __m256 e = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)&target[i])));
+        __m256i v = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(sv, s), _mm256_mul_ps(tv, e)));
+        __m128i packed = _mm_packs_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+        _mm_storel_epi64((__m128i *)&out[i], _mm_packus_epi16(packed, packed));
+    }
+    lerp_color_scalar(&start[i], &target[i], &t[i], &out[i], count - i);
+}
+#endif // PHANIM_KERNELS_X86
+
+static struct {
+    void (*rates)(const InterpFunc *, const float *, const float *, float, float *, size_t);
+    void (*lerp_float)(const float *, const float *, const float *, float *, size_t);
+    void (*lerp_vec2)(const Vector2 *, const Vector2 *, const float *, Vector2 *, size_t);
+    void (*lerp_color)(const Color *, const Color *, const float *, Color *, size_t);
+} KERNELS = { rates_scalar, lerp_float_scalar, lerp_vec2_scalar, lerp_color_scalar };
+
+const char *PhanimKernelsInit(void)
+{
+#ifdef PHANIM_KERNELS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        KERNELS.rates = rates_avx2;
+        KERNELS.lerp_float = lerp_float_avx2;
+        KERNELS.lerp_vec2 = lerp_vec2_avx2;
+        KERNELS.lerp_color = lerp_color_avx2;
+        return "AVX2";
+    }
+    // SSE2 is part of x86-64 itself
+    KERNELS.rates = rates_sse2;
+    KERNELS.lerp_float = lerp_float_sse2;
+    KERNELS.lerp_vec2 = lerp_vec2_sse2;
+    KERNELS.lerp_color = lerp_color_sse2;
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
+
+void PhanimKernelRates(const InterpFunc *func, const float *begin, const float *duration, float time, float *t, size_t count)
+{
+    KERNELS.rates(func, begin, duration, time, t, count);
+}
+
+void PhanimKernelLerpFloat(const float *start, const float *target, const float *t, float *out, size_t count)
+{
+    KERNELS.lerp_float(start, target, t, out, count);
+}
+
+void PhanimKernelLerpVec2(const Vector2 *start, const Vector2 *target, const float *t, Vector2 *out, size_t count)
+{
+    KERNELS.lerp_vec2(start, target, t, out, count);
+}
+
+void PhanimKernelLerpColor(const Color *start, const Color *target, const float *t, Color *out, size_t count)
+{
+    KERNELS.lerp_color(start, target, t, out, count);
+}
+
+#endif // PHANIM_KERNELS_IMPLEMENTATION
@@ -0,0 +1,183 @@
+#ifndef __PHLEXER_H__
+#define __PHLEXER_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Tokenizer for the textual .phanim format. It works directly on the source buffer
+// (usually a memory-mapped file) and never allocates: tokens point into the buffer
+// and carry the line and column they start at for error messages.
+
+typedef enum {
+    PHANIM_TOKEN_EOF,
+    PHANIM_TOKEN_IDENT,
+    PHANIM_TOKEN_NUMBER,
+    PHANIM_TOKEN_STRING,
+    // %NAME%, `text` is NAME
+    PHANIM_TOKEN_SECTION,
+    // One of { } ( ) , :
+    PHANIM_TOKEN_PUNCT,
+    PHANIM_TOKEN_ERROR,
+} PhanimTokenKind;
+
+typedef struct {
+    PhanimTokenKind kind;
+    // Not NUL terminated. Strings don't include their quotes, errors hold the message.
+    const char *text;
+    size_t len;
+    double number;
+    size_t line, col;
+} PhanimToken;
+
+typedef struct {
+    const char *cur, *end;
+    const char *line_start;
+    size_t line;
+} PhanimLexer;
+
+void PhanimLexerInit(PhanimLexer *lexer, const char *src, size_t size);
+PhanimToken PhanimLexerNext(PhanimLexer *lexer);
+
+#endif // __PHLEXER_H__
+
+#ifdef PHANIM_LEXER_IMPLEMENTATION
+
+static inline int lexer_is_digit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+static inline int lexer_is_ident(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || lexer_is_digit(c);
+}
+
+static inline PhanimToken lexer_error(PhanimToken tok, const char *message)
+{
+    tok.kind = PHANIM_TOKEN_ERROR;
+    tok.text = message;
+    tok.len = 0;
+    while (message[tok.len] != '\0') tok.len++;
+    return tok;
+}
+
+void PhanimLexerInit(PhanimLexer *lexer, const char *src, size_t size)
+{
+    lexer->cur = src;
+    lexer->end = src + size;
+    lexer->line_start = src;
+    lexer->line = 1;
+}
+
+// Numbers are accumulated as integers and scaled once at the end, which is exact for
+// the amount of digits scenes use and much faster than strtod()
+static PhanimToken lexer_number(PhanimLexer *l, PhanimToken tok)
+{
+    const char *p = l->cur;
+    bool negative = false;
+    if (*p == '-' || *p == '+') negative = *p++ == '-';
+
+    double mantissa = 0.0;
+    int exponent = 0;
+    size_t digits = 0;
+    for (; p < l->end && lexer_is_digit(*p); p++, digits++) mantissa = mantissa * 10.0 + (*p - '0');
+    if (p < l->end && *p == '.') {
+        for (p++; p < l->end && lexer_is_digit(*p); p++, digits++, exponent--) mantissa = mantissa * 10.0 + (*p - '0');
+    }
+    if (digits == 0) return lexer_error(tok, "Invalid number");
+
+    if (p < l->end && (*p == 'e' || *p == 'E')) {
+        p++;
+        bool negative_exp = false;
+        if (p < l->end && (*p == '-' || *p == '+')) negative_exp = *p++ == '-';
+        if (p >= l->end || !lexer_is_digit(*p)) return lexer_error(tok, "Invalid exponent");
+        int e = 0;
+        for (; p < l->end && lexer_is_digit(*p); p++) {
+            if (e < 10000) e = e * 10 + (*p - '0');
+        }
+        exponent += negative_exp ? -e : e;
+    }
+
+    static const double powers[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15 };
+    double scale = 1.0;
+    int e = exponent < 0 ? -exponent : exponent;
+    for (; e > 15; e -= 15) scale *= 1e15;
+    scale *= powers[e];
+    tok.number = exponent < 0 ? mantissa / scale : mantissa * scale;
+    if (negative) tok.number = -tok.number;
+
+    tok.kind = PHANIM_TOKEN_NUMBER;
+    tok.len = (size_t)(p - l->cur);
+    l->cur = p;
+    return tok;
+}
+
+PhanimToken PhanimLexerNext(PhanimLexer *l)
+{
+    // Whitespace and comments, which run from '#' to the end of the line
+    while (l->cur < l->end) {
+        char c = *l->cur;
+        if (c == '\n') {
+            l->cur++;
+            l->line++;
+            l->line_start = l->cur;
+        } else if (c == ' ' || c == '\t' || c == '\r') {
+            l->cur++;
+        } else if (c == '#') {
+            while (l->cur < l->end && *l->cur != '\n') l->cur++;
+        } else {
+            break;
+        }
+    }
+
+    PhanimToken tok = {
+        .kind = PHANIM_TOKEN_EOF,
+        .text = l->cur,
+        .line = l->line,
+        .col = (size_t)(l->cur - l->line_start) + 1,
+    };
+    if (l->cur >= l->end) return tok;
+
+    char c = *l->cur;
+    switch (c) {
+        case '{': case '}': case '(': case ')': case ',': case ':': {
+            tok.kind = PHANIM_TOKEN_PUNCT;
+            tok.len = 1;
+            l->cur++;
+        } break;
+
+        case '"': {
+            const char *start = ++l->cur;
+            while (l->cur < l->end && *l->cur != '"' && *l->cur != '\n') l->cur++;
+            if (l->cur >= l->end || *l->cur != '"') return lexer_error(tok, "Unterminated string");
+            tok.kind = PHANIM_TOKEN_STRING;
+            tok.text = start;
+            tok.len = (size_t)(l->cur - start);
+            l->cur++;
+        } break;
+
+        case '%': {
+            const char *start = ++l->cur;
+            while (l->cur < l->end && lexer_is_ident(*l->cur)) l->cur++;
+            if (l->cur >= l->end || *l->cur != '%' || l->cur == start) return lexer_error(tok, "Invalid section marker");
+            tok.kind = PHANIM_TOKEN_SECTION;
+            tok.text = start;
+            tok.len = (size_t)(l->cur - start);
+            l->cur++;
+        } break;
+
+        default: {
+            if (lexer_is_digit(c) || c == '-' || c == '+' || c == '.') return lexer_number(l, tok);
+            if (!lexer_is_ident(c)) {
+                l->cur++;
+                return lexer_error(tok, "Unexpected character");
+            }
+            while (l->cur < l->end && lexer_is_ident(*l->cur)) l->cur++;
+            tok.kind = PHANIM_TOKEN_IDENT;
+            tok.len = (size_t)(l->cur - tok.text);
+        } break;
+    }
+    return tok;
+}
+
+#endif // PHANIM_LEXER_IMPLEMENTATION
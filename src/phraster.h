@@ -0,0 +1,204 @@
+#ifndef __PHRASTER_H__
+#define __PHRASTER_H__
+
+#include "raylib.h"
+
+// CPU rasterizer used by the RB_CPU backend. Everything is drawn into an RGBA8
+// canvas with the same alpha blending as raylib's default blend mode and every
+// edge is anti-aliased using the pixel's approximate coverage.
+
+typedef struct {
+    Color *pixels;
+    int width, height;
+} PhanimCanvas;
+
+// Half-open pixel rectangle [x0, x1) x [y0, y1). Every draw call only touches
+// pixels inside of the clip rectangle.
+typedef struct {
+    int x0, y0, x1, y1;
+} PhanimClip;
+
+PhanimClip PhanimCanvasClip(PhanimCanvas *canvas);
+void PhanimRasterClear(PhanimCanvas *canvas, PhanimClip clip, Color color);
+void PhanimRasterCircle(PhanimCanvas *canvas, PhanimClip clip, Vector2 center, float radius, Color color);
+// Outline of a circle, `width` wide and centered on the circle's edge
+void PhanimRasterRing(PhanimCanvas *canvas, PhanimClip clip, Vector2 center, float radius, float width, Color color);
+void PhanimRasterRect(PhanimCanvas *canvas, PhanimClip clip, Vector2 top_left, Vector2 size, Color color);
+void PhanimRasterLine(PhanimCanvas *canvas, PhanimClip clip, Vector2 start, Vector2 end, float thickness, Color color);
+// `pixels` is expected to be premultiplied RGBA8, which is what resvg produces
+void PhanimRasterImage(PhanimCanvas *canvas, PhanimClip clip, const Color *pixels, int width, int height, Vector2 pos);
+
+#endif // __PHRASTER_H__
+
+#ifdef PHANIM_RASTER_IMPLEMENTATION
+#include <math.h>
+
+static inline float raster_clampf(float x, float lo, float hi)
+{
+    return x < lo ? lo : (x > hi ? hi : x);
+}
+
+// Blends `src` over `dst`, with `coverage` scaling the source alpha
+static inline void raster_blend(Color *dst, Color src, float coverage)
+{
+    int a = (int)(src.a * coverage + 0.5f);
+    if (a <= 0) return;
+    if (a >= 255) {
+        *dst = (Color){ src.r, src.g, src.b, 255 };
+        return;
+    }
+    int ia = 255 - a;
+    dst->r = (unsigned char)((src.r * a + dst->r * ia + 127) / 255);
+    dst->g = (unsigned char)((src.g * a + dst->g * ia + 127) / 255);
+    dst->b = (unsigned char)((src.b * a + dst->b * ia + 127) / 255);
+    dst->a = (unsigned char)(a + (dst->a * ia + 127) / 255);
+}
+
+// Intersects the clip rectangle with the pixels touched by [x0, x1) x [y0, y1)
+static inline PhanimClip raster_bounds(PhanimClip clip, float x0, float y0, float x1, float y1)
+{
+    PhanimClip b = {
+        .x0 = (int)floorf(x0),
+        .y0 = (int)floorf(y0),
+        .x1 = (int)ceilf(x1),
+        .y1 = (int)ceilf(y1),
+    };
+    if (b.x0 < clip.x0) b.x0 = clip.x0;
+    if (b.y0 < clip.y0) b.y0 = clip.y0;
+    if (b.x1 > clip.x1) b.x1 = clip.x1;
+    if (b.y1 > clip.y1) b.y1 = clip.y1;
+    return b;
+}
+
+PhanimClip PhanimCanvasClip(PhanimCanvas *canvas)
+{
+    return (PhanimClip){ 0, 0, canvas->width, canvas->height };
+}
+
+void PhanimRasterClear(PhanimCanvas *canvas, PhanimClip clip, Color color)
+{
+    for (int y = clip.y0; y < clip.y1; y++) {
+        Color *row = &canvas->pixels[(size_t)y * canvas->width];
+        for (int x = clip.x0; x < clip.x1; x++) {
+            row[x] = color;
+        }
+    }
+}
+
+void PhanimRasterCircle(PhanimCanvas *canvas, PhanimClip clip, Vector2 center, float radius, Color color)
+{
+    if (radius <= 0.0f || color.a == 0) return;
+    PhanimClip b = raster_bounds(
+        clip,
+        center.x - radius - 1.0f, center.y - radius - 1.0f,
+        center.x + radius + 1.0f, center.y + radius + 1.0f
+    );
+
+    for (int y = b.y0; y < b.y1; y++) {
+        Color *row = &canvas->pixels[(size_t)y * canvas->width];
+        float dy = (float)y + 0.5f - center.y;
+        for (int x = b.x0; x < b.x1; x++) {
+            float dx = (float)x + 0.5f - center.x;
+            // Signed distance to the edge approximates the covered fraction of the pixel
+            float coverage = raster_clampf(radius - sqrtf(dx*dx + dy*dy) + 0.5f, 0.0f, 1.0f);
+            if (coverage > 0.0f) raster_blend(&row[x], color, coverage);
+        }
+    }
+}
+
+void PhanimRasterRing(PhanimCanvas *canvas, PhanimClip clip, Vector2 center, float radius, float width, Color color)
+{
+    if (radius <= 0.0f || width <= 0.0f || color.a == 0) return;
+    float half = 0.5f * width;
+    float outer = radius + half;
+    PhanimClip b = raster_bounds(
+        clip,
+        center.x - outer - 1.0f, center.y - outer - 1.0f,
+        center.x + outer + 1.0f, center.y + outer + 1.0f
+    );
+
+    for (int y = b.y0; y < b.y1; y++) {
+        Color *row = &canvas->pixels[(size_t)y * canvas->width];
+        float dy = (float)y + 0.5f - center.y;
+        for (int x = b.x0; x < b.x1; x++) {
+            float dx = (float)x + 0.5f - center.x;
+            float coverage = raster_clampf(half - fabsf(sqrtf(dx*dx + dy*dy) - radius) + 0.5f, 0.0f, 1.0f);
+            if (coverage > 0.0f) raster_blend(&row[x], color, coverage);
+        }
+    }
+}
+
+void PhanimRasterRect(PhanimCanvas *canvas, PhanimClip clip, Vector2 top_left, Vector2 size, Color color)
+{
+    if (size.x <= 0.0f || size.y <= 0.0f || color.a == 0) return;
+    float x0 = top_left.x, y0 = top_left.y;
+    float x1 = x0 + size.x, y1 = y0 + size.y;
+    PhanimClip b = raster_bounds(clip, x0, y0, x1, y1);
+
+    for (int y = b.y0; y < b.y1; y++) {
+        Color *row = &canvas->pixels[(size_t)y * canvas->width];
+        // Axis aligned, so the exact coverage is the product of the overlaps per axis
+        float cy = fminf((float)y + 1.0f, y1) - fmaxf((float)y, y0);
+        for (int x = b.x0; x < b.x1; x++) {
+            float cx = fminf((float)x + 1.0f, x1) - fmaxf((float)x, x0);
+            float coverage = raster_clampf(cx, 0.0f, 1.0f) * raster_clampf(cy, 0.0f, 1.0f);
+            if (coverage > 0.0f) raster_blend(&row[x], color, coverage);
+        }
+    }
+}
+
+void PhanimRasterLine(PhanimCanvas *canvas, PhanimClip clip, Vector2 start, Vector2 end, float thickness, Color color)
+{
+    float dx = end.x - start.x, dy = end.y - start.y;
+    float length = sqrtf(dx*dx + dy*dy);
+    if (length <= 0.0f || thickness <= 0.0f || color.a == 0) return;
+
+    // Like DrawLineEx(), the line is a quad with flat ends
+    float ux = dx / length, uy = dy / length;
+    float half = 0.5f * thickness;
+    float ex = fabsf(uy) * half + 1.0f, ey = fabsf(ux) * half + 1.0f;
+    PhanimClip b = raster_bounds(
+        clip,
+        fminf(start.x, end.x) - ex, fminf(start.y, end.y) - ey,
+        fmaxf(start.x, end.x) + ex, fmaxf(start.y, end.y) + ey
+    );
+
+    for (int y = b.y0; y < b.y1; y++) {
+        Color *row = &canvas->pixels[(size_t)y * canvas->width];
+        float py = (float)y + 0.5f - start.y;
+        for (int x = b.x0; x < b.x1; x++) {
+            float px = (float)x + 0.5f - start.x;
+            // Position of the pixel center along and across the line
+            float along = px*ux + py*uy;
+            float across = fabsf(px*uy - py*ux);
+            float ca = raster_clampf(fminf(along, length - along) + 0.5f, 0.0f, 1.0f);
+            float cb = raster_clampf(half - across + 0.5f, 0.0f, 1.0f);
+            float coverage = ca * cb;
+            if (coverage > 0.0f) raster_blend(&row[x], color, coverage);
+        }
+    }
+}
+
+void PhanimRasterImage(PhanimCanvas *canvas, PhanimClip clip, const Color *pixels, int width, int height, Vector2 pos)
+{
+    int ox = (int)roundf(pos.x), oy = (int)roundf(pos.y);
+    PhanimClip b = raster_bounds(clip, (float)ox, (float)oy, (float)(ox + width), (float)(oy + height));
+
+    for (int y = b.y0; y < b.y1; y++) {
+        Color *row = &canvas->pixels[(size_t)y * canvas->width];
+        const Color *src_row = &pixels[(size_t)(y - oy) * width];
+        for (int x = b.x0; x < b.x1; x++) {
+            Color src = src_row[x - ox];
+            if (src.a == 0) continue;
+            // Premultiplied source over straight destination
+            Color *dst = &row[x];
+            int ia = 255 - src.a;
+            dst->r = (unsigned char)(src.r + (dst->r * ia + 127) / 255);
+            dst->g = (unsigned char)(src.g + (dst->g * ia + 127) / 255);
+            dst->b = (unsigned char)(src.b + (dst->b * ia + 127) / 255);
+            dst->a = (unsigned char)(src.a + (dst->a * ia + 127) / 255);
+        }
+    }
+}
+
+#endif // PHANIM_RASTER_IMPLEMENTATION
@@ -2,6 +2,7 @@
 #define __PHSTR_H__
 
 #include <stddef.h>
+#include "arena.h"
 
 typedef struct {
     char *text;
@@ -12,6 +13,8 @@ void PhanimStrInit(PhanimStr *str, const char *text);
 void PhanimStrDeinit(PhanimStr *str);
 void PhanimStrClear(PhanimStr *str);
 void PhanimStrDestroy(void);
+// The arena every string is allocated from
+Arena *PhanimStrArena(void);
 void PhanimStrAppend(PhanimStr *str, const char *text);
 void PhanimStrConcat(PhanimStr *str, PhanimStr *other);
 int PhanimStrIndexOf(PhanimStr *str, const char *pattern, size_t offset);
@@ -27,7 +30,6 @@ void PhanimStrPrint(PhanimStr *str);
 
 #ifdef PHANIM_STR_IMPLEMENTATION
 #include <string.h>
-#include "arena.h"
 
 Arena temp = {0};
 
@@ -37,7 +39,7 @@ void PhanimStrInit(PhanimStr *str, const char *text)
     str->count = n;
     str->capacity = 2 * n;
     // str->text = arena_memdup(&temp, (char*)text, n);
-    str->text = arena_alloc(&temp, n * sizeof(char));
+    str->text = arena_alloc(&temp, str->capacity * sizeof(char));
     for (size_t i = 0; i < n; i++) {
         str->text[i] = text[i];
     }
@@ -102,4 +104,9 @@ void PhanimStrDestroy(void)
     arena_free(&temp);
 }
 
+Arena *PhanimStrArena(void)
+{
+    return &temp;
+}
+
 #endif // PHSTR_IMPLEMENTATION
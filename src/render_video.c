@@ -0,0 +1,360 @@
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define PHANIM_STR_IMPLEMENTATION
+#include "phanim.h"
+#include "raylib.h"
+#include "rlgl.h"
+#include "ffmpeg.h"
+#include "scene.c"
+
+#define VIDEO_WIDTH 1920
+#define VIDEO_HEIGHT 1080
+#define VIDEO_FPS 60
+#define DEFAULT_OUTPUT_PATH "./build/output.mp4"
+// Number of frames that can be in flight between the renderer and the encoder
+#define FRAME_RING_SIZE 4
+
+// Frames are read back on the main thread and handed to a writer thread that feeds
+// ffmpeg, so drawing the next frame overlaps with encoding the previous ones. Once
+// all slots are full the main thread blocks until the writer frees one up.
+typedef struct {
+    u8 *frames[FRAME_RING_SIZE];
+    // How many more times the writer sends each frame after the first
+    size_t repeats[FRAME_RING_SIZE];
+    size_t head, count;
+    size_t width, height;
+    // Frames read back from OpenGL are upside down, the CPU framebuffer isn't
+    bool flipped;
+    bool done, failed;
+    FFMPEG *ffmpeg;
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty, not_full;
+} FrameRing;
+
+static void frame_ring_init(FrameRing *ring, FFMPEG *ffmpeg, size_t width, size_t height, bool flipped)
+{
+    *ring = (FrameRing) {
+        .width = width,
+        .height = height,
+        .flipped = flipped,
+        .ffmpeg = ffmpeg,
+    };
+    for (size_t i = 0; i < FRAME_RING_SIZE; i++) {
+        ring->frames[i] = MemAlloc(width * height * sizeof(Color));
+    }
+    pthread_mutex_init(&ring->lock, NULL);
+    pthread_cond_init(&ring->not_empty, NULL);
+    pthread_cond_init(&ring->not_full, NULL);
+}
+
+static void frame_ring_deinit(FrameRing *ring)
+{
+    for (size_t i = 0; i < FRAME_RING_SIZE; i++) {
+        MemFree(ring->frames[i]);
+    }
+    pthread_mutex_destroy(&ring->lock);
+    pthread_cond_destroy(&ring->not_empty);
+    pthread_cond_destroy(&ring->not_full);
+}
+
+static double now_seconds(void)
+{
+    // GetTime() needs a window, which the CPU backend never opens
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// Returns the next free slot, waiting for the writer if every slot is in flight. The
+// wait is what encoding costs the renderer, so that's what gets profiled as encoding.
+static u8 *frame_ring_acquire(FrameRing *ring)
+{
+    double start = now_seconds();
+    pthread_mutex_lock(&ring->lock);
+    while (ring->count == FRAME_RING_SIZE) {
+        pthread_cond_wait(&ring->not_full, &ring->lock);
+    }
+    u8 *frame = ring->frames[(ring->head + ring->count) % FRAME_RING_SIZE];
+    pthread_mutex_unlock(&ring->lock);
+    PhanimProfileAdd(PP_ENCODE, now_seconds() - start);
+    return frame;
+}
+
+// Hands the slot returned by the last frame_ring_acquire() over to the writer
+static bool frame_ring_submit(FrameRing *ring)
+{
+    pthread_mutex_lock(&ring->lock);
+    ring->count++;
+    bool failed = ring->failed;
+    pthread_cond_signal(&ring->not_empty);
+    pthread_mutex_unlock(&ring->lock);
+    return !failed;
+}
+
+// Submits the last frame again without touching its pixels. Only the main thread
+// writes into slots, so the last submitted one still holds that frame even after the
+// writer is done with it.
+static bool frame_ring_repeat(FrameRing *ring)
+{
+    pthread_mutex_lock(&ring->lock);
+    if (ring->count > 0) {
+        ring->repeats[(ring->head + ring->count - 1) % FRAME_RING_SIZE]++;
+    } else {
+        ring->head = (ring->head + FRAME_RING_SIZE - 1) % FRAME_RING_SIZE;
+        ring->count = 1;
+        pthread_cond_signal(&ring->not_empty);
+    }
+    bool failed = ring->failed;
+    pthread_mutex_unlock(&ring->lock);
+    return !failed;
+}
+
+static void frame_ring_finish(FrameRing *ring)
+{
+    pthread_mutex_lock(&ring->lock);
+    ring->done = true;
+    pthread_cond_signal(&ring->not_empty);
+    pthread_mutex_unlock(&ring->lock);
+}
+
+static void *frame_ring_writer(void *arg)
+{
+    FrameRing *ring = arg;
+    for (;;) {
+        pthread_mutex_lock(&ring->lock);
+        while (ring->count == 0 && !ring->done) {
+            pthread_cond_wait(&ring->not_empty, &ring->lock);
+        }
+        if (ring->count == 0) {
+            pthread_mutex_unlock(&ring->lock);
+            break;
+        }
+        u8 *frame = ring->frames[ring->head];
+        bool failed = ring->failed;
+        pthread_mutex_unlock(&ring->lock);
+
+        // After a failed write, frames are still drained so the renderer never blocks
+        if (!failed && ring->flipped) {
+            failed = !ffmpeg_send_frame_flipped(ring->ffmpeg, frame, ring->width, ring->height);
+        } else if (!failed) {
+            failed = !ffmpeg_send_frame(ring->ffmpeg, frame, ring->width, ring->height);
+        }
+
+        pthread_mutex_lock(&ring->lock);
+        ring->failed = failed;
+        if (ring->repeats[ring->head] > 0) {
+            ring->repeats[ring->head]--;
+        } else {
+            ring->head = (ring->head + 1) % FRAME_RING_SIZE;
+            ring->count--;
+            pthread_cond_signal(&ring->not_full);
+        }
+        pthread_mutex_unlock(&ring->lock);
+    }
+    return NULL;
+}
+
+// Renders frames [first, last) of the scene into `output_path`. The scene is
+// expected to be at the state of frame `first` already.
+static bool render_frames(const char *output_path, size_t first, size_t last, bool use_cpu, RenderTexture2D target)
+{
+    FFMPEG *ffmpeg = ffmpeg_start_rendering(output_path, VIDEO_WIDTH, VIDEO_HEIGHT, VIDEO_FPS);
+    if (ffmpeg == NULL) return false;
+
+    FrameRing ring;
+    frame_ring_init(&ring, ffmpeg, VIDEO_WIDTH, VIDEO_HEIGHT, !use_cpu);
+    pthread_t writer;
+    pthread_create(&writer, NULL, frame_ring_writer, &ring);
+
+    const float dt = 1.0f / VIDEO_FPS;
+    bool ok = true;
+    for (size_t i = first; i < last && ok; i++) {
+        // Pauses and everything after the last anim are the same frame over and over,
+        // which is neither drawn nor read back again
+        if (i > first && !PhanimFrameChanged()) {
+            ok = frame_ring_repeat(&ring);
+            PhanimProfileFrameEnd();
+            PhanimUpdate(dt);
+            continue;
+        }
+
+        u8 *frame = NULL;
+        double start = 0.0;
+        if (use_cpu) {
+            PhanimRender();
+            frame = frame_ring_acquire(&ring);
+            start = now_seconds();
+            memcpy(frame, PhanimGetFramebuffer(), VIDEO_WIDTH * VIDEO_HEIGHT * sizeof(Color));
+        } else {
+            BeginTextureMode(target);
+                ClearBackground(PhanimGetBackground());
+                PhanimRender();
+            EndTextureMode();
+
+            frame = frame_ring_acquire(&ring);
+            start = now_seconds();
+            void *pixels = rlReadTexturePixels(target.texture.id, VIDEO_WIDTH, VIDEO_HEIGHT, target.texture.format);
+            memcpy(frame, pixels, VIDEO_WIDTH * VIDEO_HEIGHT * sizeof(Color));
+            MemFree(pixels);
+        }
+        PhanimProfileAdd(PP_READBACK, now_seconds() - start);
+        ok = frame_ring_submit(&ring);
+        PhanimProfileFrameEnd();
+
+        PhanimUpdate(dt);
+    }
+
+    frame_ring_finish(&ring);
+    pthread_join(writer, NULL);
+    ok = ok && !ring.failed;
+    frame_ring_deinit(&ring);
+    return ffmpeg_end_rendering(ffmpeg, !ok) && ok;
+}
+
+// Splits the video into `jobs` contiguous chunks, each rendered by a forked worker
+// into its own segment, and stitches the segments together at the end. Every worker
+// starts off with its own copy of the freshly built scene and fast-forwards it to
+// the start of its chunk before rendering anything.
+static bool render_frames_parallel(const char *output_path, size_t frame_count, size_t jobs)
+{
+    if (jobs > frame_count) jobs = frame_count > 0 ? frame_count : 1;
+
+    // Rasterizer threads are split evenly between the workers
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t threads = cores > (long)jobs ? (size_t)cores / jobs : 1;
+
+    char **segments = MemAlloc(jobs * sizeof(char*));
+    pid_t *pids = MemAlloc(jobs * sizeof(pid_t));
+    bool ok = true;
+    for (size_t k = 0; k < jobs; k++) {
+        segments[k] = MemAlloc(strlen(output_path) + 32);
+        sprintf(segments[k], "%s.part%zu.mp4", output_path, k);
+
+        size_t first = frame_count * k / jobs;
+        size_t last = frame_count * (k + 1) / jobs;
+        pids[k] = fork();
+        if (pids[k] == 0) {
+            PhanimSetRenderThreads(threads);
+            // Stepping instead of PhanimSeek(first * dt) on purpose: the time adds up
+            // the same float rounding as in the sequential export, so every chunk comes
+            // out bit for bit like those frames would. An update costs microseconds,
+            // next to milliseconds for every frame the worker renders.
+            const float dt = 1.0f / VIDEO_FPS;
+            for (size_t i = 0; i < first; i++) {
+                PhanimUpdate(dt);
+            }
+            // Fast-forwarding isn't part of any frame
+            if (PhanimIsProfiling()) PhanimSetProfiling(true);
+            _exit(render_frames(segments[k], first, last, true, (RenderTexture2D){0}) ? 0 : 1);
+        }
+        if (pids[k] < 0) {
+            TraceLog(LOG_ERROR, "Failed to fork worker %zu: %s", k, strerror(errno));
+            ok = false;
+            jobs = k;
+            break;
+        }
+    }
+
+    for (size_t k = 0; k < jobs; k++) {
+        int status = 0;
+        if (waitpid(pids[k], &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            TraceLog(LOG_ERROR, "Worker %zu failed to render '%s'", k, segments[k]);
+            ok = false;
+        }
+    }
+
+    if (ok) ok = ffmpeg_concat((const char**)segments, jobs, output_path);
+
+    for (size_t k = 0; k < jobs; k++) {
+        unlink(segments[k]);
+        MemFree(segments[k]);
+    }
+    MemFree(segments);
+    MemFree(pids);
+    return ok;
+}
+
+static void usage(const char *program)
+{
+    fprintf(stderr, "Usage: %s [--cpu] [--jobs N] [--bake] [--profile FILE] [output]\n", program);
+    fprintf(stderr, "    --cpu       Rasterize on the CPU, without a window or GL context\n");
+    fprintf(stderr, "    --jobs N    Render N chunks of the video in parallel processes (implies --cpu)\n");
+    fprintf(stderr, "    --bake      Sample every animated property up front instead of on every frame\n");
+    fprintf(stderr, "    --profile FILE\n");
+    fprintf(stderr, "                Write the time of every phase of every frame to FILE, as JSON lines\n");
+    fprintf(stderr, "                if it ends in .json and as CSV otherwise\n");
+}
+
+int main(int argc, char **argv)
+{
+    const char *output_path = DEFAULT_OUTPUT_PATH;
+    bool use_cpu = false;
+    bool bake = false;
+    const char *profile_path = NULL;
+    size_t jobs = 1;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--cpu") == 0) {
+            use_cpu = true;
+        } else if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) {
+            // A GL context can't be shared with forked processes
+            use_cpu = true;
+            int n = atoi(argv[++i]);
+            jobs = n > 0 ? (size_t)n : 1;
+        } else if (strcmp(argv[i], "--bake") == 0) {
+            bake = true;
+        } else if (strcmp(argv[i], "--profile") == 0 && i + 1 < argc) {
+            profile_path = argv[++i];
+        } else if (argv[i][0] == '-') {
+            usage(argv[0]);
+            return 1;
+        } else {
+            output_path = argv[i];
+        }
+    }
+
+    SetTraceLogLevel(LOG_WARNING);
+    RenderTexture2D target = {0};
+    if (use_cpu) {
+        PhanimInitEx(RB_CPU, VIDEO_WIDTH, VIDEO_HEIGHT);
+    } else {
+        // A hidden window is only needed for the GL context. Nothing is ever presented,
+        // so there is no vsync and no SetTargetFPS() throttling; frames are produced as
+        // fast as they can be drawn and encoded.
+        SetConfigFlags(FLAG_WINDOW_HIDDEN);
+        InitWindow(VIDEO_WIDTH, VIDEO_HEIGHT, "Physics Animations - Render");
+        PhanimInit();
+    }
+
+    if (profile_path != NULL) {
+        if (!PhanimProfileDump(profile_path)) return 1;
+        PhanimSetProfiling(true);
+    }
+
+    SceneMain();
+    PhanimPrepareTex();
+    if (bake) PhanimBake(VIDEO_FPS);
+    if (!use_cpu) target = LoadRenderTexture(VIDEO_WIDTH, VIDEO_HEIGHT);
+
+    size_t frame_count = (size_t)ceilf(PhanimTotalAnimTime() * VIDEO_FPS) + 1;
+    TraceLog(LOG_WARNING, "Rendering %zu frames to '%s'", frame_count, output_path);
+
+    double start = now_seconds();
+    bool ok = jobs > 1
+        ? render_frames_parallel(output_path, frame_count, jobs)
+        : render_frames(output_path, 0, frame_count, use_cpu, target);
+    double elapsed = now_seconds() - start;
+    if (ok) {
+        TraceLog(LOG_WARNING, "Rendered %zu frames in %.2fs (%.1f fps)", frame_count, elapsed, frame_count / elapsed);
+    }
+
+    if (!use_cpu) UnloadRenderTexture(target);
+    PhanimDeinit();
+    if (!use_cpu) CloseWindow();
+    return ok ? 0 : 1;
+}
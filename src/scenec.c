@@ -0,0 +1,19 @@
+#define PHANIM_STR_IMPLEMENTATION
+#include <stdio.h>
+#include "phanim.h"
+
+// Compiles a textual .phanim scene into a scene file that PhanimLoadScene() maps
+// directly, so big scenes load without being parsed again
+int main(int argc, char **argv)
+{
+    if (argc != 3) {
+        fprintf(stderr, "Usage: %s <input.phanim> <output.phscene>\n", argv[0]);
+        return 1;
+    }
+
+    SetTraceLogLevel(LOG_WARNING);
+    PhanimInit();
+    bool ok = PhanimLoadSceneText(argv[1]) && PhanimSaveScene(argv[2]);
+    PhanimDeinit();
+    return ok ? 0 : 1;
+}